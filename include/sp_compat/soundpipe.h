@@ -7,9 +7,5 @@
 #include "../../deps/soundpipe/h/base.h"
 #include "../../deps/soundpipe/h/ftbl.h"
 #include "../../deps/soundpipe/h/randmt.h"
-#include "../../deps/soundpipe/h/adsr.h"
-#include "../../deps/soundpipe/h/moogladder.h"
-#include "../../deps/soundpipe/h/fosc.h"
-#include "../../deps/soundpipe/h/osc.h"
 
 #endif // SOUNDPIPE_H
@@ -7,30 +7,68 @@ OUT_DIR="$ROOT_DIR/web/dist"
 
 mkdir -p "$OUT_DIR"
 
-echo "[1/2] Building WASM (synth.js/wasm)"
-emcc \
-  -O3 \
-  "$ROOT_DIR/src/wavetable_synth.cpp" \
-  "$SP_DIR/modules/base.c" \
-  "$SP_DIR/modules/ftbl.c" \
-  "$SP_DIR/modules/randmt.c" \
-  "$SP_DIR/modules/osc.c" \
-  "$SP_DIR/modules/adsr.c" \
-  "$SP_DIR/modules/moogladder.c" \
-  "$SP_DIR/modules/fosc.c" \
-  -DNO_LIBSNDFILE=1 \
-  -I"$ROOT_DIR/include/sp_compat" \
-  -I"$SP_DIR/h" \
-  -s WASM=1 \
-  -s MODULARIZE=1 \
-  -s EXPORT_ES6=1 \
-  -s EXPORT_NAME=createSynthModule \
-  -s USE_ES6_IMPORT_META=1 \
-  -s ENVIRONMENT=web,worker \
-  -s SINGLE_FILE=1 \
-  -s ALLOW_MEMORY_GROWTH=1 \
-  -s NO_EXIT_RUNTIME=1 \
-  -s EXPORTED_FUNCTIONS='["_synth_init","_synth_set_freq","_synth_set_amp","_synth_set_wave","_synth_set_wave1","_synth_set_wave2","_synth_set_detune1","_synth_set_detune2","_synth_set_gain1","_synth_set_gain2","_synth_fm1","_synth_fm2","_synth_render","_synth_note_on","_synth_note_off","_synth_note_off_midi","_synth_set_env","_synth_set_poly","_synth_filter_set","_synth_filter_env","_synth_filter_env_amount","_synth_lfo_set","_synth_lfo_amount_semi","_synth_lfo_dest","_synth_lfo_amount","_synth_shutdown","_malloc","_free"]' \
-  -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","HEAPF32"]' \
-  -o "$OUT_DIR/synth.js"
-echo "[2/2] Done. Outputs in web/dist/"
+# SYNTH_THREADS=N builds with Emscripten pthreads and a pool of N workers for
+# synth_set_threads. Needs SharedArrayBuffer (cross-origin isolated page) and a
+# host that can start workers; the default build renders on the caller only.
+THREAD_FLAGS=()
+if [[ "${SYNTH_THREADS:-0}" -gt 1 ]]; then
+  THREAD_FLAGS=(-pthread -s PTHREAD_POOL_SIZE="$SYNTH_THREADS")
+fi
+
+# The wasm ships as separate files, compiled once on the main thread by
+# web/player.js (streaming) and instantiated by the worklet: synth.wasm with
+# wasm SIMD (4 voices per instruction), synth-nosimd.wasm for engines without
+# it. Both use the same JS glue, synth.js. The heap is a fixed
+# SYNTH_HEAP_MB (default 128) so it never grows, and never reallocates, on the
+# audio thread; size it for the user wavetables a page loads (a 256-frame
+# table of 2048 samples takes ~25 MB with its mip levels).
+HEAP_BYTES=$(( ${SYNTH_HEAP_MB:-128} * 1024 * 1024 ))
+TMP_DIR="$(mktemp -d)"
+trap 'rm -rf "$TMP_DIR"' EXIT
+mkdir -p "$TMP_DIR/simd" "$TMP_DIR/scalar"
+
+build() {
+  emcc \
+    -O3 \
+    "$@" \
+    "$ROOT_DIR/src/wavetable_synth.cpp" \
+    "$ROOT_DIR/src/wavetable_bank.cpp" \
+    "$ROOT_DIR/src/voice_dsp.cpp" \
+    "$ROOT_DIR/src/fm_dsp.cpp" \
+    "$ROOT_DIR/src/synth_patch.cpp" \
+    "$ROOT_DIR/src/worker_pool.cpp" \
+    "$SP_DIR/modules/base.c" \
+    "$SP_DIR/modules/ftbl.c" \
+    "$SP_DIR/modules/randmt.c" \
+    ${THREAD_FLAGS[@]+"${THREAD_FLAGS[@]}"} \
+    -DNO_LIBSNDFILE=1 \
+    -I"$ROOT_DIR/include/sp_compat" \
+    -I"$SP_DIR/h" \
+    -s WASM=1 \
+    -s MODULARIZE=1 \
+    -s EXPORT_ES6=1 \
+    -s EXPORT_NAME=createSynthModule \
+    -s USE_ES6_IMPORT_META=1 \
+    -s ENVIRONMENT=web,worker \
+    -s FILESYSTEM=0 \
+    -s INITIAL_MEMORY="$HEAP_BYTES" \
+    -s ALLOW_MEMORY_GROWTH=0 \
+    -s ABORTING_MALLOC=0 \
+    -s NO_EXIT_RUNTIME=1 \
+    -s EXPORTED_FUNCTIONS='["_synth_create","_synth_destroy","_synth_init","_synth_memory_bytes","_synth_set_freq","_synth_set_amp","_synth_set_smoothing","_synth_set_wave","_synth_set_wave1","_synth_set_wave2","_synth_set_wave_crossfade","_synth_wavetable_create","_synth_wavetable_release","_synth_wavetable_in_use","_synth_wavetable_ready","_synth_set_position1","_synth_set_position2","_synth_set_detune1","_synth_set_detune2","_synth_set_gain1","_synth_set_gain2","_synth_fm1","_synth_fm2","_synth_fm_algorithm","_synth_fm_feedback","_synth_fm_op","_synth_fm_op_env","_synth_render","_synth_render_planar","_synth_set_pan","_synth_set_spread","_synth_unison","_synth_unison_phase","_synth_post_event","_synth_event_queue","_synth_set_frame","_synth_get_frame","_synth_stats","_synth_stats_reset","_synth_get_state","_synth_load_state","_synth_set_governor","_synth_set_governor_limits","_synth_set_quality","_synth_get_quality","_synth_set_threads","_synth_note_on","_synth_note_off","_synth_note_off_midi","_synth_active_voices","_synth_set_env","_synth_set_poly","_synth_filter_set","_synth_filter_env","_synth_filter_env_amount","_synth_filter_enable","_synth_filter_mode","_synth_lfo_set","_synth_lfo_amount_semi","_synth_lfo_dest","_synth_lfo_amount","_synth_mod_route","_synth_mod_lfo","_synth_mod_wheel","_synth_shutdown","_malloc","_free"]' \
+    -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","HEAPU8","HEAPF32","HEAP32","HEAPU32"]'
+}
+
+echo "[1/3] Building WASM with SIMD (synth.js/synth.wasm)"
+build -msimd128 -o "$TMP_DIR/simd/synth.js"
+echo "[2/3] Building WASM without SIMD (synth-nosimd.wasm)"
+build -o "$TMP_DIR/scalar/synth.js"
+# player.js picks a wasm by feature detection and the worklet imports one glue
+if ! cmp -s "$TMP_DIR/simd/synth.js" "$TMP_DIR/scalar/synth.js"; then
+  echo "JS glue differs between the SIMD and scalar builds" >&2
+  exit 1
+fi
+cp "$TMP_DIR/simd/synth.js" "$OUT_DIR/synth.js"
+cp "$TMP_DIR/simd/synth.wasm" "$OUT_DIR/synth.wasm"
+cp "$TMP_DIR/scalar/synth.wasm" "$OUT_DIR/synth-nosimd.wasm"
+echo "[3/3] Done. Outputs in web/dist/"
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::size_t CACHE_LINE = 64;
+
+// Bump allocator over one block reserved up front. A layout function makes
+// the same carve() calls twice: first on an arena without memory, which only
+// measures, then on the allocated block, which hands out the pointers. Every
+// carve starts on a cache line; the block is never grown or freed piecemeal.
+struct Arena {
+    uint8_t* base = nullptr; // null while measuring
+    std::size_t used = 0;
+
+    template <class T>
+    T* carve(std::size_t count = 1) {
+        static_assert(alignof(T) <= CACHE_LINE, "arena blocks are cache-line aligned");
+        used = (used + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+        T* p = base ? reinterpret_cast<T*>(base + used) : nullptr;
+        used += sizeof(T) * count;
+        return p;
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Timestamped engine event. A plain 32-byte record so hosts can fill slots
+// directly in memory (the worklet copies them in from a SharedArrayBuffer).
+// Field meaning per type is listed with SynthEventType in wavetable_synth.h.
+struct SynthEvent {
+    uint32_t frame;   // engine frame to apply at; frames already reached apply immediately
+    int32_t type;     // SynthEventType
+    int32_t i;
+    float a, b, c, d;
+    uint32_t reserved;
+};
+static_assert(sizeof(SynthEvent) == 32, "SynthEvent layout is shared with JS");
+
+constexpr uint32_t EVENT_QUEUE_SIZE = 1024; // power of two
+
+// Lock-free single-producer/single-consumer ring. Indices run freely and are
+// masked on access; the producer publishes `write` after filling the slot and
+// the consumer releases the slot by advancing `read`. Events are applied in
+// queue order, so producers keep frames non-decreasing; one stamped earlier than
+// its predecessor applies together with it. Header layout (u32 words): write,
+// read, capacity, then padding to 32 bytes before the events.
+struct EventQueue {
+    std::atomic<uint32_t> write{0};
+    std::atomic<uint32_t> read{0};
+    uint32_t capacity = EVENT_QUEUE_SIZE;
+    uint32_t reserved[5] = {};
+    SynthEvent events[EVENT_QUEUE_SIZE];
+
+    // Producer side; false when full
+    bool push(const SynthEvent& ev) {
+        uint32_t w = write.load(std::memory_order_relaxed);
+        if (w - read.load(std::memory_order_acquire) >= EVENT_QUEUE_SIZE) return false;
+        events[w & (EVENT_QUEUE_SIZE - 1)] = ev;
+        write.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: oldest pending event, or nullptr
+    const SynthEvent* peek() const {
+        uint32_t r = read.load(std::memory_order_relaxed);
+        if (r == write.load(std::memory_order_acquire)) return nullptr;
+        return &events[r & (EVENT_QUEUE_SIZE - 1)];
+    }
+
+    void pop() { read.store(read.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer side: drop everything pending
+    void clear() { read.store(write.load(std::memory_order_acquire), std::memory_order_release); }
+};
+static_assert(sizeof(std::atomic<uint32_t>) == 4, "EventQueue header layout is shared with JS");
@@ -0,0 +1,153 @@
+#include "fm_dsp.h"
+
+#include <cmath>
+
+namespace {
+    constexpr int W = SIMD_WIDTH;
+    constexpr int SINE_BITS = 12;
+    constexpr int SINE_SIZE = 1 << SINE_BITS;
+    constexpr int FRAC_BITS = 32 - SINE_BITS;
+    constexpr uint32_t FRAC_MASK = (1u << FRAC_BITS) - 1;
+    constexpr int CHUNK = 64; // samples per pass over the operators
+    // Radians to fixed-point phase, 2^24 per cycle (shifted up to 2^32 after
+    // the int conversion); clamped so the conversion stays in range
+    constexpr float PM_SCALE = 16777216.0f / (2.0f * (float)M_PI);
+    constexpr float PM_LIMIT = 2.0e9f;
+
+    // Modulators of each operator (bit j = operator j + 1) and the carriers
+    struct Algorithm {
+        uint8_t mods[FM_OPS];
+        uint8_t carriers;
+    };
+    constexpr Algorithm ALGORITHMS[FM_ALGORITHMS] = {
+        {{0x2, 0x4, 0x8, 0}, 0x1},
+        {{0x2, 0xc, 0, 0}, 0x1},
+        {{0xa, 0x4, 0, 0}, 0x1},
+        {{0x6, 0, 0x8, 0}, 0x1},
+        {{0x2, 0, 0x8, 0}, 0x5},
+        {{0x8, 0x8, 0x8, 0}, 0x7},
+        {{0, 0, 0x8, 0}, 0x7},
+        {{0, 0, 0, 0}, 0xf},
+    };
+
+    // One cycle of sine plus a guard point for the interpolation, shared by every engine
+    struct SineTable {
+        float v[SINE_SIZE + 1];
+        SineTable() {
+            for (int i = 0; i <= SINE_SIZE; ++i) v[i] = (float)std::sin(2.0 * M_PI * i / SINE_SIZE);
+        }
+    };
+
+    const float* sine_table() {
+        static const SineTable table;
+        return table.v;
+    }
+
+    inline void store_live(float* dst, vfloat v, vmask live) { v_store(dst, v_sel(live, v, v_load(dst))); }
+
+    // One operator over n samples: y = gain * sin(phase + mod (+ feedback)).
+    // step is the increment in cycles before the per-sample pitch multiplier.
+    template <bool FEEDBACK>
+    void op_run(vuint& phase, vfloat step, const float* pitch, const float* mod, const float* gain, float* y,
+                int n, vfloat& fb1, vfloat& fb2, float fb_amt) {
+        const float* tbl = sine_table();
+        vfloat lo = v_set1(-PM_LIMIT), hi = v_set1(PM_LIMIT), max_inc = v_set1(0.99999994f);
+        vuint ph = phase;
+        int32_t i0[W];
+        float a[W], b[W];
+        for (int i = 0; i < n; ++i) {
+            vfloat m = mod ? v_load(mod + i * W) : v_set1(0.0f);
+            if (FEEDBACK) m = m + (fb1 + fb2) * fb_amt;
+            vuint pm = ph + (v_as_uint(v_to_int(v_clamp(m * PM_SCALE, lo, hi))) << 8);
+            v_store_int(i0, v_as_int(pm >> FRAC_BITS));
+            vfloat fr = v_to_float(v_as_int(pm & FRAC_MASK)) * (1.0f / (float)(1u << FRAC_BITS));
+            for (int l = 0; l < W; ++l) { a[l] = tbl[i0[l]]; b[l] = tbl[i0[l] + 1]; }
+            vfloat va = v_load(a);
+            vfloat s = va + (v_load(b) - va) * fr;
+            if (FEEDBACK) { fb2 = fb1; fb1 = s; }
+            v_store(y + i * W, s * v_load(gain + i * W));
+            // Increments below one cycle per sample, so the conversion stays in range
+            vfloat inc = v_min(step * pitch[i], max_inc);
+            ph = ph + (v_as_uint(v_to_int(inc * 2147483648.0f)) << 1);
+        }
+        phase = ph;
+    }
+}
+
+void fm_reset(FmState& f) {
+    std::memset(&f, 0, sizeof(f));
+}
+
+void fm_reset_voice(FmState& f, int v) {
+    for (auto& ph : f.phase) ph[v] = 0;
+    f.fb[0][v] = f.fb[1][v] = 0.0f;
+    for (EnvState& e : f.env) env_reset_voice(e, v);
+}
+
+void fm_gate(FmState& f, const FmPatch& p, int v, float gate, float sr) {
+    for (int op = 0; op < FM_OPS; ++op) {
+        if (p.op[op].env_on) env_gate(f.env[op], v, gate, p.op[op].env, sr);
+    }
+}
+
+void fm_kernel(FmState& f, const FmPatch& p, int v0, const float* live, const float* hz, const float* pitch,
+               const float* index, float sr, float* out, int n) {
+    const Algorithm& alg = ALGORITHMS[p.algorithm];
+    vmask keep = v_load(live + v0) > 0.5f;
+    // Operators at level 0 are skipped, phases and all
+    int sounding = 0;
+    for (int op = 0; op < FM_OPS; ++op) if (p.op[op].level != 0.0f) sounding |= 1 << op;
+    float norm = 1.0f / (float)__builtin_popcount(alg.carriers);
+    float fb_amt = p.feedback * 0.5f * (float)M_PI; // on the mean of the last two outputs
+    float inv_sr = 1.0f / sr;
+
+    vuint ph[FM_OPS];
+    for (int op = 0; op < FM_OPS; ++op) ph[op] = v_load_uint(f.phase[op] + v0);
+    vfloat fb1 = v_load(f.fb[0] + v0), fb2 = v_load(f.fb[1] + v0);
+
+    VOICE_ALIGN float op_out[FM_OPS][CHUNK * W];
+    VOICE_ALIGN float mod[CHUNK * W];
+    VOICE_ALIGN float gain[CHUNK * W];
+    for (int c = 0; c < n; c += CHUNK) {
+        int len = n - c < CHUNK ? n - c : CHUNK;
+        float* dst = out + c * W;
+        std::memset(dst, 0, sizeof(float) * len * W);
+        // Modulators before the operators they modulate: always higher numbers
+        for (int op = FM_OPS - 1; op >= 0; --op) {
+            if (!(sounding >> op & 1)) continue;
+            const FmOp& o = p.op[op];
+            bool carrier = alg.carriers >> op & 1;
+            bool feedback = op == FM_OPS - 1 && fb_amt != 0.0f;
+            int srcs = alg.mods[op] & sounding;
+            if (srcs) {
+                int first = __builtin_ctz(srcs);
+                std::memcpy(mod, op_out[first], sizeof(float) * len * W);
+                for (int src = first + 1; src < FM_OPS; ++src) {
+                    if (!(srcs >> src & 1)) continue;
+                    for (int k = 0; k < len * W; k += W) v_store(mod + k, v_load(mod + k) + v_load(op_out[src] + k));
+                }
+            }
+            // Gain per sample: level, times the envelope and, for modulators, the index
+            if (o.env_on) env_kernel(f.env[op], v0, o.env, sr, live, gain, len);
+            for (int i = 0; i < len; ++i) {
+                float lv = carrier ? o.level : o.level * index[c + i];
+                v_store(gain + i * W, o.env_on ? v_load(gain + i * W) * lv : v_set1(lv));
+            }
+            vfloat step = v_load(hz) * (o.ratio * inv_sr); // cycles per sample before the pitch multiplier
+            const float* m = srcs ? mod : nullptr;
+            if (feedback) op_run<true>(ph[op], step, pitch + c, m, gain, op_out[op], len, fb1, fb2, fb_amt);
+            else op_run<false>(ph[op], step, pitch + c, m, gain, op_out[op], len, fb1, fb2, fb_amt);
+            if (!carrier) continue;
+            for (int k = 0; k < len * W; k += W) v_store(dst + k, v_load(dst + k) + v_load(op_out[op] + k));
+        }
+        for (int k = 0; k < len * W; k += W) v_store(dst + k, v_load(dst + k) * norm);
+    }
+
+    uint32_t tmp[W];
+    for (int op = 0; op < FM_OPS; ++op) {
+        v_store_uint(tmp, ph[op]);
+        for (int l = 0; l < W; ++l) if (live[v0 + l] > 0.5f) f.phase[op][v0 + l] = tmp[l];
+    }
+    store_live(f.fb[0] + v0, fb1, keep);
+    store_live(f.fb[1] + v0, fb2, keep);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Linearly smoothed control parameter. Setters retarget it (with any derived
+// value, e.g. a detune ratio, computed once at set time); the renderer advances
+// it once per block into a per-sample ramp, so parameter jumps never zipper.
+struct SmoothedParam {
+    float value = 0.0f;  // value reached at the end of the last rendered block
+    float target = 0.0f;
+    float step = 0.0f;   // per-sample increment while ramping
+    int remaining = 0;   // samples left in the ramp
+
+    SmoothedParam() = default;
+    explicit SmoothedParam(float v) : value(v), target(v) {}
+
+    void reset(float v) { value = target = v; step = 0.0f; remaining = 0; }
+
+    void set(float t, int ramp_samples) {
+        if (ramp_samples <= 0 || t == value) { reset(t); return; }
+        target = t;
+        step = (t - value) / (float)ramp_samples;
+        remaining = ramp_samples;
+    }
+
+    // Write the next n per-sample values into dst and advance
+    void fill(float* dst, int n) {
+        int i = 0;
+        for (; i < n && remaining > 0; ++i) {
+            value = --remaining > 0 ? value + step : target;
+            dst[i] = value;
+        }
+        for (; i < n; ++i) dst[i] = value;
+    }
+
+    // Advance n samples like fill, without writing them
+    void advance(int n) {
+        for (int i = 0; i < n && remaining > 0; ++i) value = --remaining > 0 ? value + step : target;
+    }
+};
+
+// 2^x for control-rate code (scalar twin of v_exp2 in simd.h); ~3e-6 relative error
+inline float exp2_fast(float x) {
+    if (x < -126.0f) x = -126.0f;
+    if (x > 126.0f) x = 126.0f;
+    float r = x + 0.5f;
+    int32_t n = static_cast<int32_t>(r);
+    if (static_cast<float>(n) > r) --n; // floor
+    float f = x - static_cast<float>(n);
+    float p = 1.3333558e-3f;
+    p = p * f + 9.6181291e-3f;
+    p = p * f + 5.5504109e-2f;
+    p = p * f + 2.4022651e-1f;
+    p = p * f + 6.9314718e-1f;
+    p = p * f + 1.0f;
+    int32_t bits = (n + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// log2(x) for x > 0, ~1.5e-3 absolute error; used for mip level selection
+inline float log2_fast(float x) {
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    float e = static_cast<float>(((bits >> 23) & 0xff) - 127);
+    bits = (bits & 0x007fffff) | 0x3f800000; // mantissa in [1, 2)
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    // Least-squares cubic for log2(m) on [1, 2), exact at m = 1
+    float p = ((0.16557608f * m - 1.0844817f) * m + 3.0957254f) * m - 2.1768198f;
+    return e + p;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// Voice-parallel SIMD helpers. A vfloat carries one voice per lane, so kernels
+// process SIMD_WIDTH voices per instruction (4 on SSE2 / WASM SIMD128 / NEON,
+// 8 on AVX2). Every helper is a plain per-lane IEEE operation -- no FMA, no
+// libm -- so a build with SYNTH_NO_SIMD runs the same kernels on scalar floats
+// and produces bit-identical output.
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(SYNTH_NO_SIMD)
+#define SIMD_WIDTH 1
+#elif defined(__AVX2__)
+#define SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(__wasm_simd128__) || defined(__ARM_NEON)
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 1
+#endif
+
+#if SIMD_WIDTH > 1
+typedef float vfloat __attribute__((vector_size(SIMD_WIDTH * 4)));
+typedef int32_t vint __attribute__((vector_size(SIMD_WIDTH * 4)));
+typedef uint32_t vuint __attribute__((vector_size(SIMD_WIDTH * 4))); // wrapping fixed-point phases
+typedef vint vmask; // lane is all ones when true
+
+inline vint v_to_int(vfloat x) { return __builtin_convertvector(x, vint); }   // truncates
+inline vfloat v_to_float(vint x) { return __builtin_convertvector(x, vfloat); }
+inline vfloat v_as_float(vint x) { vfloat f; std::memcpy(&f, &x, sizeof(f)); return f; }
+inline vuint v_as_uint(vint x) { return (vuint)x; }
+inline vint v_as_int(vuint x) { return (vint)x; }
+inline bool v_any(vmask m) {
+    for (int i = 0; i < SIMD_WIDTH; ++i) if (m[i]) return true;
+    return false;
+}
+#else
+typedef float vfloat;
+typedef int32_t vint;
+typedef uint32_t vuint;
+typedef bool vmask;
+
+inline vint v_to_int(vfloat x) { return static_cast<int32_t>(x); }
+inline vfloat v_to_float(vint x) { return static_cast<float>(x); }
+inline vfloat v_as_float(vint x) { float f; std::memcpy(&f, &x, sizeof(f)); return f; }
+inline vuint v_as_uint(vint x) { return static_cast<uint32_t>(x); }
+inline vint v_as_int(vuint x) { return static_cast<int32_t>(x); }
+inline bool v_any(vmask m) { return m; }
+#endif
+
+inline vfloat v_set1(float x) { return vfloat{} + x; }
+inline vfloat v_load(const float* p) { vfloat v; std::memcpy(&v, p, sizeof(v)); return v; }
+inline void v_store(float* p, vfloat v) { std::memcpy(p, &v, sizeof(v)); }
+inline void v_store_int(int32_t* p, vint v) { std::memcpy(p, &v, sizeof(v)); }
+inline vuint v_load_uint(const uint32_t* p) { vuint v; std::memcpy(&v, p, sizeof(v)); return v; }
+inline void v_store_uint(uint32_t* p, vuint v) { std::memcpy(p, &v, sizeof(v)); }
+inline vfloat v_sel(vmask m, vfloat a, vfloat b) { return m ? a : b; }
+inline vfloat v_min(vfloat a, vfloat b) { return a < b ? a : b; }
+inline vfloat v_max(vfloat a, vfloat b) { return a > b ? a : b; }
+inline vfloat v_clamp(vfloat x, vfloat lo, vfloat hi) { return v_min(v_max(x, lo), hi); }
+
+inline vfloat v_floor(vfloat x) {
+    vfloat t = v_to_float(v_to_int(x));
+    return v_sel(t > x, t - 1.0f, t);
+}
+
+// 2^x for |x| < 126; ~3e-6 relative error (degree 5 polynomial on [-0.5, 0.5])
+inline vfloat v_exp2(vfloat x) {
+    x = v_clamp(x, v_set1(-126.0f), v_set1(126.0f));
+    vfloat n = v_floor(x + 0.5f);
+    vfloat f = x - n;
+    vfloat p = v_set1(1.3333558e-3f);
+    p = p * f + 9.6181291e-3f;
+    p = p * f + 5.5504109e-2f;
+    p = p * f + 2.4022651e-1f;
+    p = p * f + 6.9314718e-1f;
+    p = p * f + 1.0f;
+    return p * v_as_float((v_to_int(n) + 127) << 23);
+}
+
+// tanh via Lambert's continued fraction (7 terms), clamped where it reaches +-1
+inline vfloat v_tanh(vfloat x) {
+    x = v_clamp(x, v_set1(-4.97f), v_set1(4.97f));
+    vfloat x2 = x * x;
+    vfloat num = x * (((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f);
+    vfloat den = ((x2 * 28.0f + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+    return num / den;
+}
+
+// Cheaper tanh: x (27 + x^2) / (27 + 9 x^2), exactly +-1 from |x| = 3; ~2%
+// error, smooth and monotonic, which is all a saturator needs
+inline vfloat v_tanh_fast(vfloat x) {
+    x = v_clamp(x, v_set1(-3.0f), v_set1(3.0f));
+    vfloat x2 = x * x;
+    return x * (x2 + 27.0f) / (x2 * 9.0f + 27.0f);
+}
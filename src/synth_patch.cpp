@@ -0,0 +1,144 @@
+#include "synth_patch.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr int HEADER_BYTES = 12;
+
+    struct Writer {
+        uint8_t* p;
+        uint32_t version = PATCH_VERSION;
+        void u32(uint32_t v) {
+            for (int k = 0; k < 4; ++k) *p++ = (uint8_t)(v >> (8 * k));
+        }
+        void f(float& v) { uint32_t u; std::memcpy(&u, &v, 4); u32(u); }
+        void i(int& v) { u32((uint32_t)v); }
+    };
+
+    struct Reader {
+        const uint8_t* p;
+        const uint8_t* end;
+        uint32_t version = PATCH_VERSION;
+        bool ok = true;
+        uint32_t u32() {
+            if (end - p < 4) { ok = false; return 0; }
+            uint32_t v = 0;
+            for (int k = 0; k < 4; ++k) v |= (uint32_t)*p++ << (8 * k);
+            return v;
+        }
+        void f(float& v) {
+            uint32_t u = u32();
+            float x;
+            std::memcpy(&x, &u, 4);
+            if (!std::isfinite(x)) ok = false;
+            if (ok) v = x;
+        }
+        void i(int& v) {
+            uint32_t u = u32();
+            if (ok) v = (int32_t)u;
+        }
+    };
+
+    // Counts bytes instead of writing them
+    struct Sizer {
+        int bytes = 0;
+        uint32_t version = PATCH_VERSION;
+        void f(float&) { bytes += 4; }
+        void i(int&) { bytes += 4; }
+    };
+
+    template <class Io>
+    void env_fields(Io& io, EnvParams& e) { io.f(e.atk); io.f(e.dec); io.f(e.sus); io.f(e.rel); }
+
+    // The field list shared by every direction; fields of later versions are
+    // skipped when reading an older patch
+    template <class Io>
+    void patch_fields(Io& io, SynthPatch& p) {
+        io.f(p.amp);
+        io.f(p.smooth_ms);
+        env_fields(io, p.env);
+        io.i(p.poly);
+        io.f(p.cutoff);
+        io.f(p.resonance);
+        io.i(p.filter_on);
+        io.i(p.filter_mode);
+        env_fields(io, p.fenv);
+        io.f(p.fenv_amt);
+        io.f(p.lfo_rate);
+        io.f(p.lfo_amt_semi);
+        io.i(p.lfo_dest);
+        io.f(p.lfo_amt);
+        io.f(p.wave_fade_ms);
+        for (int o = 0; o < 2; ++o) {
+            io.i(p.wave[o]);
+            io.f(p.detune[o]);
+            io.f(p.gain[o]);
+            io.f(p.position[o]);
+            io.f(p.fm_index[o]);
+            FmPatch& fm = p.fm[o];
+            io.i(fm.algorithm);
+            io.f(fm.feedback);
+            for (FmOp& op : fm.op) {
+                int on = op.env_on ? 1 : 0;
+                io.f(op.ratio);
+                io.f(op.level);
+                io.i(on);
+                op.env_on = on != 0;
+                env_fields(io, op.env);
+            }
+        }
+        io.f(p.pan);
+        io.f(p.spread);
+        if (io.version < 2) return;
+        for (int o = 0; o < 2; ++o) {
+            io.i(p.unison_voices[o]);
+            io.f(p.unison_detune[o]);
+            io.f(p.unison_curve[o]);
+            io.f(p.unison_width[o]);
+            io.f(p.unison_random[o]);
+        }
+        if (io.version < 3) return;
+        for (int& shape : p.lfo_shape) io.i(shape);
+        for (float& rate : p.lfo_rate23) io.f(rate);
+        for (PatchRoute& r : p.routes) {
+            io.i(r.source);
+            io.i(r.dest);
+            io.f(r.amount);
+        }
+    }
+}
+
+int patch_size() {
+    Sizer sz;
+    SynthPatch p;
+    patch_fields(sz, p);
+    return HEADER_BYTES + sz.bytes;
+}
+
+int patch_encode(const SynthPatch& p, uint8_t* out, int capacity) {
+    int size = patch_size();
+    if (!out || capacity < size) return 0;
+    Writer w{out};
+    w.u32(PATCH_MAGIC);
+    w.u32(PATCH_VERSION);
+    w.u32((uint32_t)size);
+    SynthPatch copy = p; // the field visitor takes references
+    patch_fields(w, copy);
+    return size;
+}
+
+bool patch_decode(SynthPatch& p, const uint8_t* data, int size) {
+    if (!data || size < HEADER_BYTES) return false;
+    Reader r{data, data + size};
+    uint32_t magic = r.u32(), version = r.u32(), total = r.u32();
+    if (magic != PATCH_MAGIC || version < 1 || version > PATCH_VERSION || total > (uint32_t)size) return false;
+    r.end = data + total;
+    r.version = version;
+    SynthPatch tmp;
+    patch_fields(r, tmp);
+    if (!r.ok) return false;
+    for (int o = 0; o < 2; ++o) tmp.det_ratio[o] = std::pow(2.0f, tmp.detune[o] / 12.0f);
+    p = tmp;
+    return true;
+}
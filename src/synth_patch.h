@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "fm_dsp.h"
+#include "wavetable_synth.h"
+
+// One modulation matrix slot (synth_mod_route)
+struct PatchRoute {
+    int source = -1;
+    int dest = 0;
+    float amount = 0.0f;
+};
+
+// A complete engine patch as plain values: what synth_get_state saves and
+// synth_load_state applies. Wave numbers refer to the built-in shapes or to the
+// engine's user table slots, which the host keeps loaded across patches.
+struct SynthPatch {
+    float amp = 0.4f;
+    float smooth_ms = 10.0f;
+    EnvParams env{0.01f, 0.1f, 0.8f, 0.2f};
+    int poly = 8;
+    float cutoff = 1200.0f;
+    float resonance = 0.3f;
+    int filter_on = 1;
+    int filter_mode = 0;
+    EnvParams fenv{0.005f, 0.15f, 0.0f, 0.25f};
+    float fenv_amt = 2000.0f;
+    float lfo_rate = 5.0f;
+    float lfo_amt_semi = 0.0f;
+    int lfo_dest = 0;
+    float lfo_amt = 0.0f;
+    float wave_fade_ms = 5.0f;
+    // Per oscillator
+    int wave[2] = {0, 0};
+    float detune[2] = {0.0f, 0.0f};
+    float gain[2] = {0.5f, 0.5f};
+    float position[2] = {0.0f, 0.0f};
+    float fm_index[2] = {2.0f, 2.0f};
+    FmPatch fm[2];
+    float pan = 0.0f;
+    float spread = 0.0f;
+    // Version 2: unison per oscillator
+    int unison_voices[2] = {1, 1};
+    float unison_detune[2] = {0.2f, 0.2f};
+    float unison_curve[2] = {0.0f, 0.0f};
+    float unison_width[2] = {0.0f, 0.0f};
+    float unison_random[2] = {0.0f, 0.0f};
+    // Version 3: modulation matrix
+    int lfo_shape[3] = {0, 0, 0};
+    float lfo_rate23[2] = {5.0f, 5.0f}; // LFOs 2 and 3 (LFO 1 is lfo_rate)
+    PatchRoute routes[SYNTH_MOD_ROUTES];
+
+    // Derived by patch_decode, so applying a patch computes nothing
+    float det_ratio[2] = {1.0f, 1.0f};
+};
+
+// Binary format: little-endian 32-bit words. Header: magic, version, total
+// size in bytes; then the fields of SynthPatch in declaration order (ints as
+// i32, floats as f32, FM operators as ratio, level, env_on, attack, decay,
+// sustain, release). Fields added by later versions go at the end, so a
+// decoder reads any version up to its own and leaves newer fields at their
+// defaults.
+constexpr uint32_t PATCH_MAGIC = 0x50535457; // "WTSP"
+constexpr uint32_t PATCH_VERSION = 3;
+
+// Encoded size of a patch of the current version
+int patch_size();
+// Write p into out; returns the size, or 0 (nothing written) if capacity is short
+int patch_encode(const SynthPatch& p, uint8_t* out, int capacity);
+// Read a patch. False for a wrong magic, a newer version, a truncated buffer or
+// non-finite values; p is only written on success.
+bool patch_decode(SynthPatch& p, const uint8_t* data, int size);
+
+// Latest-wins handoff of decoded patches from one loading thread to the
+// rendering thread (triple buffer): the producer fills its own slot and swaps
+// it into the middle; the consumer swaps the middle out when it is marked
+// fresh. Neither side waits and a patch is never read while being written.
+struct PatchMailbox {
+    static constexpr int FRESH = 4;
+    SynthPatch slot[3];
+    std::atomic<int> middle{1};
+    int back = 0;  // producer's slot
+    int front = 2; // consumer's slot
+
+    // Producer side: the slot to fill, then publish() it
+    SynthPatch& fill() { return slot[back]; }
+    void publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3; }
+
+    // Consumer side: the newest published patch, or nullptr if none since the last take
+    const SynthPatch* take() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return nullptr;
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        return &slot[front];
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Engine telemetry, written by the rendering thread at the end of every render
+// call and polled by anyone else (a UI thread, or JS straight from the WASM
+// heap) without locks. Every field is an independent 32-bit word, so a reader
+// sees each value whole; values from different fields may straddle a render
+// call. `renders` advances last, so a poller can tell when a new block is in.
+// Layout (u32 words; f = f32):
+//   0 renders        render calls since creation
+//   1 frames         frames in the last call
+//   2 render_us   f  wall time of the last call
+//   3 deadline_us f  real time the last call covered (frames / sample rate)
+//   4 load        f  render_us / deadline_us of the last call (1 = no headroom)
+//   5 load_peak   f  highest load since the last reset
+//   6 load_avg    f  load averaged over about a second
+//   7 voices         voices in use after the last call
+//   8 voices_peak    most voices in use at once since the last reset
+//   9 steals         voices stolen for new notes
+//  10 events         events applied during the last call
+//  11 events_total   events applied since the last reset
+//  12 nan_blocks     internal blocks whose mix was NaN/Inf (they are muted)
+//  13 denormal_blocks internal blocks whose mix held denormals
+//  14 overruns       calls that took longer than their deadline
+//  15 dropouts       gaps in the host timeline (synth_set_frame skipped ahead)
+//  16 peak        f  highest |sample| of the last call's mix, before the output gain
+//  17 rms         f  RMS of the last call's mix
+//  18 quality        CPU governor quality level (0 = full, see synth_set_governor)
+struct SynthStats {
+    std::atomic<uint32_t> renders{0};
+    std::atomic<uint32_t> frames{0};
+    std::atomic<float> render_us{0.0f};
+    std::atomic<float> deadline_us{0.0f};
+    std::atomic<float> load{0.0f};
+    std::atomic<float> load_peak{0.0f};
+    std::atomic<float> load_avg{0.0f};
+    std::atomic<uint32_t> voices{0};
+    std::atomic<uint32_t> voices_peak{0};
+    std::atomic<uint32_t> steals{0};
+    std::atomic<uint32_t> events{0};
+    std::atomic<uint32_t> events_total{0};
+    std::atomic<uint32_t> nan_blocks{0};
+    std::atomic<uint32_t> denormal_blocks{0};
+    std::atomic<uint32_t> overruns{0};
+    std::atomic<uint32_t> dropouts{0};
+    std::atomic<float> peak{0.0f};
+    std::atomic<float> rms{0.0f};
+    std::atomic<uint32_t> quality{0};
+};
+constexpr int SYNTH_STATS_WORDS = 19;
+static_assert(sizeof(std::atomic<float>) == 4 && sizeof(std::atomic<uint32_t>) == 4,
+              "SynthStats layout is shared with JS");
+static_assert(sizeof(SynthStats) == SYNTH_STATS_WORDS * 4, "SynthStats layout is shared with JS");
@@ -0,0 +1,241 @@
+#include "voice_dsp.h"
+
+#include <cmath>
+
+namespace {
+    constexpr int W = SIMD_WIDTH;
+    constexpr float THERMAL = 0.000025f;
+    constexpr float ZDF_DRIVE = 0.25f; // ZDF ladder input headroom: saturation sets in around +-4
+
+    float tau2pole(float tau, float sr) { return expf(-1.0f / (tau * sr)); }
+
+    // Load/store one group of lanes, keeping the old state of lanes that are not live
+    inline void store_live(float* dst, vfloat v, vmask live) { v_store(dst, v_sel(live, v, v_load(dst))); }
+}
+
+void env_reset(EnvState& e) {
+    std::memset(&e, 0, sizeof(e));
+}
+
+void ladder_reset(LadderState& f) {
+    std::memset(&f, 0, sizeof(f));
+}
+
+void zdf_reset(ZdfState& f) {
+    std::memset(&f, 0, sizeof(f));
+}
+
+void env_reset_voice(EnvState& e, int v) {
+    e.y[v] = e.x[v] = e.a[v] = e.b[v] = 0.0f;
+    e.timer[v] = e.atk_time[v] = e.stage[v] = e.gate[v] = 0.0f;
+}
+
+void ladder_reset_voice(LadderState& f, int v) {
+    for (auto& d : f.delay) d[v] = 0.0f;
+    for (auto& t : f.tanhstg) t[v] = 0.0f;
+}
+
+void zdf_reset_voice(ZdfState& f, int v) {
+    for (auto& st : f.s) st[v] = 0.0f;
+    f.x1[v] = 0.0f;
+}
+
+void env_gate(EnvState& e, int v, float gate, const EnvParams& p, float sr) {
+    if (e.gate[v] < gate) {
+        float pole = tau2pole(p.atk * 0.75f, sr);
+        e.a[v] = pole;
+        e.b[v] = 1.0f - pole;
+        e.timer[v] = 0.0f;
+        e.atk_time[v] = (float)(uint32_t)(p.atk * sr * 1.5f);
+        e.stage[v] = 1.0f;
+        e.x[v] = 1.0f;
+    } else if (e.gate[v] > gate) {
+        float pole = tau2pole(p.rel, sr);
+        e.a[v] = pole;
+        e.b[v] = 1.0f - pole;
+        e.stage[v] = 0.0f;
+        e.x[v] = 0.0f;
+    } else if (gate > 0.0f && e.stage[v] == 0.0f) {
+        e.x[v] = gate * p.sus; // sustain level follows the current setting
+    }
+    e.gate[v] = gate;
+}
+
+void env_kernel(EnvState& e, int v0, const EnvParams& p, float sr, const float* live, float* out, int n) {
+    vmask keep = v_load(live + v0) > 0.5f;
+    vfloat y = v_load(e.y + v0), x = v_load(e.x + v0);
+    vfloat a = v_load(e.a + v0), b = v_load(e.b + v0);
+    vfloat timer = v_load(e.timer + v0), atk_time = v_load(e.atk_time + v0);
+    vfloat stage = v_load(e.stage + v0);
+    bool attacking = v_any(stage > 0.5f);
+    float dec_pole = attacking ? tau2pole(p.dec, sr) : 0.0f;
+    vfloat dec_a = v_set1(dec_pole), dec_b = v_set1(1.0f - dec_pole), sus = v_set1(p.sus);
+    vfloat zero = v_set1(0.0f);
+    for (int i = 0; i < n; ++i) {
+        vmask in_atk = stage > 0.5f;
+        timer = v_sel(in_atk, timer + 1.0f, timer);
+        y = b * x + a * y;
+        v_store(out + i * W, y);
+        if (attacking) {
+            vmask done = in_atk & ((y > 0.99f) | (timer > atk_time));
+            a = v_sel(done, dec_a, a);
+            b = v_sel(done, dec_b, b);
+            x = v_sel(done, sus, x);
+            stage = v_sel(done, zero, stage);
+        }
+    }
+    store_live(e.y + v0, y, keep);
+    store_live(e.x + v0, x, keep);
+    store_live(e.a + v0, a, keep);
+    store_live(e.b + v0, b, keep);
+    store_live(e.timer + v0, timer, keep);
+    store_live(e.stage + v0, stage, keep);
+}
+
+namespace {
+    // OVERSAMPLE stage updates per sample: 2 is the reference model, 1 halves
+    // the cost (tanh count) with a slightly less accurate cutoff and resonance
+    template <int OVERSAMPLE>
+    void ladder_run(LadderState& f, int v0, const float* live, float* io, const float* cutoff, const float* res,
+                    float sr, int n) {
+        vmask keep = v_load(live + v0) > 0.5f;
+        vfloat d0 = v_load(f.delay[0] + v0), d1 = v_load(f.delay[1] + v0), d2 = v_load(f.delay[2] + v0);
+        vfloat d3 = v_load(f.delay[3] + v0), d4 = v_load(f.delay[4] + v0), d5 = v_load(f.delay[5] + v0);
+        vfloat t0 = v_load(f.tanhstg[0] + v0), t1 = v_load(f.tanhstg[1] + v0), t2 = v_load(f.tanhstg[2] + v0);
+        const float inv_sr = 1.0f / sr;
+        const float k_exp = -2.0f * (float)M_PI * 1.44269504f; // -2pi / ln 2
+        for (int i = 0; i < n; ++i) {
+            vfloat fc = v_load(cutoff + i * W) * inv_sr;
+            vfloat fc2 = fc * fc, fc3 = fc2 * fc;
+            vfloat fcr = fc3 * 1.8730f + fc2 * 0.4955f - fc * 0.6490f + 0.9988f;
+            vfloat acr = fc2 * -3.9364f + fc * 1.8409f + 0.9968f;
+            vfloat tune = (1.0f - v_exp2(fc * (1.0f / OVERSAMPLE) * fcr * k_exp)) * (1.0f / THERMAL);
+            vfloat res4 = acr * (4.0f * res[i]);
+            vfloat in = v_load(io + i * W);
+            for (int j = 0; j < OVERSAMPLE; ++j) {
+                vfloat stg0 = d0 + tune * (v_tanh((in - res4 * d5) * THERMAL) - t0);
+                d0 = stg0;
+                t0 = v_tanh(stg0 * THERMAL);
+                vfloat stg1 = d1 + tune * (t0 - t1);
+                d1 = stg1;
+                t1 = v_tanh(stg1 * THERMAL);
+                vfloat stg2 = d2 + tune * (t1 - t2);
+                d2 = stg2;
+                t2 = v_tanh(stg2 * THERMAL);
+                vfloat stg3 = d3 + tune * (t2 - v_tanh(d3 * THERMAL));
+                d3 = stg3;
+                d5 = (stg3 + d4) * 0.5f;
+                d4 = stg3;
+            }
+            v_store(io + i * W, d5);
+        }
+        store_live(f.delay[0] + v0, d0, keep);
+        store_live(f.delay[1] + v0, d1, keep);
+        store_live(f.delay[2] + v0, d2, keep);
+        store_live(f.delay[3] + v0, d3, keep);
+        store_live(f.delay[4] + v0, d4, keep);
+        store_live(f.delay[5] + v0, d5, keep);
+        store_live(f.tanhstg[0] + v0, t0, keep);
+        store_live(f.tanhstg[1] + v0, t1, keep);
+        store_live(f.tanhstg[2] + v0, t2, keep);
+    }
+}
+
+void ladder_kernel(LadderState& f, int v0, const float* live, float* io, const float* cutoff,
+                   const float* res, float sr, int n) {
+    ladder_run<2>(f, v0, live, io, cutoff, res, sr, n);
+}
+
+void ladder_kernel_fast(LadderState& f, int v0, const float* live, float* io, const float* cutoff,
+                        const float* res, float sr, int n) {
+    ladder_run<1>(f, v0, live, io, cutoff, res, sr, n);
+}
+
+namespace {
+    // Prewarped integrator gain tan(pi fc / rate) of every lane at sample i
+    inline vfloat zdf_gain(const float* cutoff, int i, float pi_over_rate) {
+        float g[W];
+        for (int l = 0; l < W; ++l) g[l] = std::tan(cutoff[i * W + l] * pi_over_rate);
+        return v_load(g);
+    }
+
+    // One sample of the ZDF ladder: four TPT one-poles (y = G x + (1 - G) s)
+    // in a loop whose feedback is solved for the input, then saturated
+    inline vfloat zdf_ladder_step(vfloat x, vfloat g, vfloat k, vfloat& s0, vfloat& s1, vfloat& s2, vfloat& s3) {
+        vfloat big = g / (g + 1.0f), beta = 1.0f - big;
+        vfloat g2 = big * big;
+        vfloat sum = beta * (((s0 * big + s1) * big + s2) * big + s3); // y4 with a zero input
+        vfloat u = (x - k * sum) / (k * (g2 * g2) + 1.0f);
+        u = v_tanh_fast(u * ZDF_DRIVE) * (1.0f / ZDF_DRIVE);
+        vfloat v = (u - s0) * big, y = v + s0;
+        s0 = y + v;
+        v = (y - s1) * big; y = v + s1;
+        s1 = y + v;
+        v = (y - s2) * big; y = v + s2;
+        s2 = y + v;
+        v = (y - s3) * big; y = v + s3;
+        s3 = y + v;
+        return y;
+    }
+}
+
+void zdf_ladder_kernel(ZdfState& f, int v0, const float* live, float* io, const float* cutoff,
+                       const float* res, float sr, int n, int control, bool oversample) {
+    vmask keep = v_load(live + v0) > 0.5f;
+    vfloat s0 = v_load(f.s[0] + v0), s1 = v_load(f.s[1] + v0), s2 = v_load(f.s[2] + v0), s3 = v_load(f.s[3] + v0);
+    vfloat x1 = v_load(f.x1 + v0);
+    float pi_over_rate = (float)M_PI / (oversample ? 2.0f * sr : sr);
+    vfloat g = zdf_gain(cutoff, 0, pi_over_rate);
+    for (int i = 0; i < n; i += control) {
+        int len = n - i < control ? n - i : control;
+        vfloat g_end = zdf_gain(cutoff, i + len - 1, pi_over_rate);
+        vfloat dg = (g_end - g) * (1.0f / (float)len);
+        for (int j = i; j < i + len; ++j) {
+            g = g + dg;
+            vfloat k = v_set1(4.0f * res[j]);
+            vfloat x = v_load(io + j * W);
+            if (oversample) {
+                vfloat a = zdf_ladder_step((x1 + x) * 0.5f, g, k, s0, s1, s2, s3);
+                vfloat b = zdf_ladder_step(x, g, k, s0, s1, s2, s3);
+                x1 = x;
+                v_store(io + j * W, (a + b) * 0.5f);
+            } else {
+                v_store(io + j * W, zdf_ladder_step(x, g, k, s0, s1, s2, s3));
+            }
+        }
+        g = g_end;
+    }
+    store_live(f.s[0] + v0, s0, keep);
+    store_live(f.s[1] + v0, s1, keep);
+    store_live(f.s[2] + v0, s2, keep);
+    store_live(f.s[3] + v0, s3, keep);
+    store_live(f.x1 + v0, x1, keep);
+}
+
+void svf_kernel(ZdfState& f, int v0, const float* live, float* io, const float* cutoff,
+                const float* res, float sr, int n, int control) {
+    vmask keep = v_load(live + v0) > 0.5f;
+    vfloat ic1 = v_load(f.s[0] + v0), ic2 = v_load(f.s[1] + v0);
+    float pi_over_rate = (float)M_PI / sr;
+    vfloat g = zdf_gain(cutoff, 0, pi_over_rate);
+    for (int i = 0; i < n; i += control) {
+        int len = n - i < control ? n - i : control;
+        vfloat g_end = zdf_gain(cutoff, i + len - 1, pi_over_rate);
+        vfloat dg = (g_end - g) * (1.0f / (float)len);
+        for (int j = i; j < i + len; ++j) {
+            g = g + dg;
+            // Damping 2 (no resonance) down to 0.04 at res = 1
+            vfloat k = v_set1(2.0f - 1.96f * res[j]);
+            vfloat a1 = 1.0f / (g * (g + k) + 1.0f), a2 = g * a1, a3 = g * a2;
+            vfloat v3 = v_load(io + j * W) - ic2;
+            vfloat v1 = a1 * ic1 + a2 * v3;
+            vfloat v2 = ic2 + a2 * ic1 + a3 * v3;
+            ic1 = v1 * 2.0f - ic1;
+            ic2 = v2 * 2.0f - ic2;
+            v_store(io + j * W, v2);
+        }
+        g = g_end;
+    }
+    store_live(f.s[0] + v0, ic1, keep);
+    store_live(f.s[1] + v0, ic2, keep);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "simd.h"
+
+// Structure-of-arrays voice DSP. Each state array holds one float per voice;
+// kernels run a group of SIMD_WIDTH consecutive voices starting at v0 and read
+// or write per-sample lane-interleaved buffers (buf[i * SIMD_WIDTH + lane]).
+// Lanes whose `live` flag is 0 are computed but their state is not written
+// back, so idle voices keep exactly the state they had in a scalar build.
+
+// Upper bound on polyphony; a multiple of every SIMD_WIDTH and of 64 (voice
+// bitmasks). Idle slots cost memory only: rendering skips them.
+constexpr int MAX_VOICES = 128;
+
+#define VOICE_ALIGN alignas(64) // cache line
+
+// One-pole exponential ADSR (same curve as Soundpipe's sp_adsr)
+struct EnvParams {
+    float atk = 0.1f, dec = 0.1f, sus = 0.5f, rel = 0.3f;
+};
+
+struct EnvState {
+    VOICE_ALIGN float y[MAX_VOICES];        // output
+    VOICE_ALIGN float x[MAX_VOICES];        // target: 1 in attack, sus in decay, 0 in release
+    VOICE_ALIGN float a[MAX_VOICES];        // pole
+    VOICE_ALIGN float b[MAX_VOICES];        // 1 - pole
+    VOICE_ALIGN float timer[MAX_VOICES];    // samples since attack start
+    VOICE_ALIGN float atk_time[MAX_VOICES]; // attack timeout in samples
+    VOICE_ALIGN float stage[MAX_VOICES];    // 1 while in attack, 0 otherwise
+    float gate[MAX_VOICES];                 // last gate seen, for edge detection
+};
+
+// Moog ladder (Huovilainen model, 2x oversampled, as in Soundpipe's sp_moogladder)
+struct LadderState {
+    VOICE_ALIGN float delay[6][MAX_VOICES];
+    VOICE_ALIGN float tanhstg[3][MAX_VOICES];
+};
+
+// Zero-delay-feedback filters (topology-preserving transform): integrator
+// states of the 4-pole ladder, of which the SVF uses the first two
+struct ZdfState {
+    VOICE_ALIGN float s[4][MAX_VOICES];
+    VOICE_ALIGN float x1[MAX_VOICES]; // previous input, for the 2x oversampled ladder
+};
+
+void env_reset(EnvState& e);
+void ladder_reset(LadderState& f);
+void zdf_reset(ZdfState& f);
+// Clear one voice's lane, as if freshly reset
+void env_reset_voice(EnvState& e, int v);
+void ladder_reset_voice(LadderState& f, int v);
+void zdf_reset_voice(ZdfState& f, int v);
+
+// Apply a gate change for voice v (rising edge starts attack, falling edge release)
+// and refresh the decay target. Call once per block before env_kernel.
+void env_gate(EnvState& e, int v, float gate, const EnvParams& p, float sr);
+
+// n samples of envelope output for voices v0..v0+SIMD_WIDTH-1 into out[n * SIMD_WIDTH]
+void env_kernel(EnvState& e, int v0, const EnvParams& p, float sr, const float* live, float* out, int n);
+
+// In-place ladder filter over io[n * SIMD_WIDTH]. cutoff is per lane and sample
+// (Hz), res is per sample (0..1, shared by all lanes).
+void ladder_kernel(LadderState& f, int v0, const float* live, float* io, const float* cutoff,
+                   const float* res, float sr, int n);
+// Same filter without oversampling: half the cost, slightly less accurate
+// tuning at high cutoffs (the CPU governor's economy mode)
+void ladder_kernel_fast(LadderState& f, int v0, const float* live, float* io, const float* cutoff,
+                        const float* res, float sr, int n);
+
+// ZDF ladder (24 dB/oct) with a fast tanh saturating the feedback input; the
+// feedback loop is solved per sample, so it stays in tune and stable up to
+// self-oscillation at res = 1. Cutoffs are read every 'control' samples (the
+// tan prewarp is computed there and ramped in between). oversample runs it
+// at 2x for cleaner high-resonance/high-cutoff sweeps.
+void zdf_ladder_kernel(ZdfState& f, int v0, const float* live, float* io, const float* cutoff,
+                       const float* res, float sr, int n, int control, bool oversample);
+// ZDF state-variable lowpass (12 dB/oct), the cheapest mode; same arguments
+void svf_kernel(ZdfState& f, int v0, const float* live, float* io, const float* cutoff,
+                const float* res, float sr, int n, int control);
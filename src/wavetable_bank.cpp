@@ -0,0 +1,162 @@
+#include "wavetable_bank.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
+int next_pow2(int n) {
+    int p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void fft_complex(double* re, double* im, int n, bool inverse) {
+    // Bit-reversal permutation
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        double ang = 2.0 * M_PI / len * (inverse ? 1.0 : -1.0);
+        double wr = std::cos(ang), wi = std::sin(ang);
+        for (int i = 0; i < n; i += len) {
+            double cr = 1.0, ci = 0.0;
+            for (int k = 0; k < len / 2; ++k) {
+                int a = i + k, b = i + k + len / 2;
+                double xr = re[b] * cr - im[b] * ci;
+                double xi = re[b] * ci + im[b] * cr;
+                re[b] = re[a] - xr; im[b] = im[a] - xi;
+                re[a] += xr; im[a] += xi;
+                double t = cr * wr - ci * wi;
+                ci = cr * wi + ci * wr;
+                cr = t;
+            }
+        }
+    }
+}
+
+namespace {
+    // Sine-series amplitude of partial n for a built-in shape
+    double partial_amp(int shape, int n) {
+        switch (shape) {
+            case WAVE_SAW: return 1.0 / n;
+            case WAVE_SQUARE: return (n & 1) ? 1.0 / n : 0.0;
+            case WAVE_TRIANGLE: {
+                if (!(n & 1)) return 0.0;
+                double a = 1.0 / ((double)n * n);
+                return ((n >> 1) & 1) ? -a : a;
+            }
+            case WAVE_SINE: default: return n == 1 ? 1.0 : 0.0;
+        }
+    }
+}
+
+void mip_build(MipTable& mt, int shape, int size) {
+    int half = size / 2;
+    int levels = 1;
+    if (shape != WAVE_SINE) {
+        while ((half >> levels) >= 1) ++levels;
+    }
+    mt.size = size;
+    mt.levels = levels;
+    mt.data.assign(static_cast<std::size_t>(levels) * (size + 1), 0.0f);
+
+    std::vector<double> re(size), im(size);
+    double peak = 0.0;
+    for (int l = 0; l < levels; ++l) {
+        int partials = half >> l;
+        if (partials < 1) partials = 1;
+        if (partials > half - 1) partials = half - 1; // keep Nyquist bin empty
+        for (int k = 0; k < size; ++k) { re[k] = 0.0; im[k] = 0.0; }
+        // sin(n x) = (e^{inx} - e^{-inx}) / 2i -> bin n gets -a/2 i, bin size-n gets +a/2 i
+        for (int n = 1; n <= partials; ++n) {
+            double a = partial_amp(shape, n);
+            im[n] = -0.5 * a;
+            im[size - n] = 0.5 * a;
+        }
+        fft_complex(re.data(), im.data(), size, /*inverse*/true);
+        float* dst = mt.data.data() + static_cast<std::size_t>(l) * (size + 1);
+        for (int k = 0; k < size; ++k) {
+            dst[k] = static_cast<float>(re[k]);
+            double m = std::fabs(re[k]);
+            if (m > peak) peak = m;
+        }
+        dst[size] = dst[0];
+    }
+    // One gain for every level so loudness does not step between octaves
+    if (peak > 0.0) {
+        float g = static_cast<float>(1.0 / peak);
+        for (float& v : mt.data) v *= g;
+    }
+}
+
+void frame_table_init(FrameTable& ft, const float* raw, int frames, int size) {
+    int levels = 1;
+    while (((size / 2) >> levels) >= 1) ++levels;
+    ft.raw = raw;
+    ft.frames = frames;
+    ft.size = size;
+    ft.levels = levels;
+    ft.mips.assign(static_cast<std::size_t>(frames) * levels * (size + 1), 0.0f);
+    ft.built.store(0);
+    ft.level_next = 0;
+    ft.spec_re.assign(size, 0.0);
+    ft.spec_im.assign(size, 0.0);
+    ft.re.assign(size, 0.0);
+    ft.im.assign(size, 0.0);
+}
+
+std::size_t frame_table_bytes(const FrameTable& ft) {
+    return sizeof(FrameTable) + ft.mips.size() * sizeof(float) +
+           (ft.spec_re.size() + ft.spec_im.size() + ft.re.size() + ft.im.size()) * sizeof(double);
+}
+
+bool frame_table_build_step(FrameTable& ft) {
+    int frame = ft.built.load(std::memory_order_relaxed);
+    if (frame >= ft.frames) return false;
+    int size = ft.size, half = size / 2;
+    if (ft.level_next == 0) {
+        // Spectrum of the frame, truncated per level below
+        const float* src = ft.raw + static_cast<std::size_t>(frame) * size;
+        for (int k = 0; k < size; ++k) { ft.spec_re[k] = src[k]; ft.spec_im[k] = 0.0; }
+        fft_complex(ft.spec_re.data(), ft.spec_im.data(), size, /*inverse*/false);
+    }
+    int l = ft.level_next;
+    int partials = half >> l;
+    if (partials < 1) partials = 1;
+    if (partials > half - 1) partials = half - 1; // keep Nyquist bin empty
+    double scale = 1.0 / size;
+    for (int k = 0; k < size; ++k) { ft.re[k] = 0.0; ft.im[k] = 0.0; }
+    ft.re[0] = ft.spec_re[0] * scale; // DC kept, so the switch from raw is seamless
+    for (int n = 1; n <= partials; ++n) {
+        ft.re[n] = ft.spec_re[n] * scale; ft.im[n] = ft.spec_im[n] * scale;
+        ft.re[size - n] = ft.spec_re[size - n] * scale; ft.im[size - n] = ft.spec_im[size - n] * scale;
+    }
+    fft_complex(ft.re.data(), ft.im.data(), size, /*inverse*/true);
+    float* dst = ft.mips.data() + (static_cast<std::size_t>(frame) * ft.levels + l) * (size + 1);
+    for (int k = 0; k < size; ++k) dst[k] = static_cast<float>(ft.re[k]);
+    dst[size] = dst[0];
+    if (++ft.level_next == ft.levels) {
+        ft.level_next = 0;
+        ft.built.store(frame + 1, std::memory_order_release); // publish the whole frame
+    }
+    return true;
+}
+
+const MipTable& mip_builtin(int shape, int size) {
+    static std::mutex lock;
+    static std::map<std::pair<int, int>, MipTable> cache; // node addresses are stable
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cache.find({shape, size});
+    if (it == cache.end()) {
+        it = cache.emplace(std::make_pair(shape, size), MipTable{}).first;
+        mip_build(it->second, shape, size);
+    }
+    return it->second;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Built-in oscillator shapes (matches synth_set_wave* numbering)
+enum WaveShape {
+    WAVE_SINE = 0,
+    WAVE_SAW = 1,
+    WAVE_SQUARE = 2,
+    WAVE_TRIANGLE = 3,
+    WAVE_SHAPE_COUNT = 4
+};
+
+// Band-limited wavetable mipmap: one table per octave. Level l holds partials
+// 1..max(1, size/2 >> l), so it is alias-free for fundamentals up to
+// sample_rate * 2^l / size.
+struct MipTable {
+    int size = 0;   // samples per level (power of two)
+    int levels = 0;
+    std::vector<float> data; // levels * (size + 1); last sample of a level repeats the first
+
+    const float* level(int l) const { return data.data() + static_cast<std::size_t>(l) * (size + 1); }
+};
+
+// Build all mip levels of a built-in shape from its harmonic spectrum using an
+// inverse FFT. size must be a power of two >= 64.
+void mip_build(MipTable& mt, int shape, int size);
+
+// Built-in table for (shape, size), built on first request and kept for the
+// life of the process. The reference stays valid, so engines hold pointers.
+const MipTable& mip_builtin(int shape, int size);
+
+// Multi-frame user wavetable: `frames` single cycles of `size` samples, read in
+// place from memory the host owns. Band-limited mip levels (same layout and
+// partial counts as MipTable) are built frame by frame afterwards; frames not
+// yet built play from the raw samples.
+struct FrameTable {
+    const float* raw = nullptr; // frames * size, frame after frame (not owned)
+    int frames = 0;
+    int size = 0;               // power of two
+    int levels = 0;
+    std::vector<float> mips;    // frames * levels * (size + 1)
+    std::atomic<int> built{0};  // frames [0, built) have mips; only grows
+    std::atomic<bool> cancel{false};
+
+    // Builder state (owned by whoever runs frame_table_build_step)
+    int level_next = 0;
+    std::vector<double> spec_re, spec_im, re, im;
+
+    // Mip level l of a frame, or the raw frame while it is not built. The raw
+    // frame has no guard sample, so readers wrap the second tap themselves.
+    const float* level(int frame, int l, int built_frames) const {
+        if (frame >= built_frames) return raw + static_cast<std::size_t>(frame) * size;
+        return mips.data() + (static_cast<std::size_t>(frame) * levels + l) * (size + 1);
+    }
+};
+
+// Set up a table over raw (allocates every mip level up front)
+void frame_table_init(FrameTable& ft, const float* raw, int frames, int size);
+// Memory the table owns: its mip levels and the builder's buffers (raw is the host's)
+std::size_t frame_table_bytes(const FrameTable& ft);
+// Build one mip level of the next unbuilt frame; false once all are built.
+// Cheap enough (one inverse FFT) to run a step per audio callback.
+bool frame_table_build_step(FrameTable& ft);
+
+// In-place radix-2 complex FFT (n must be a power of two). The inverse is unscaled.
+void fft_complex(double* re, double* im, int n, bool inverse);
+
+// Smallest power of two >= n
+int next_pow2(int n);
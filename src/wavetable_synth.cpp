@@ -1,512 +1,1976 @@
+#include <atomic>
+#include <cfloat>
+#include <chrono>
 #include <cmath>
 #include <cstring>
-#include <string>
-#include <vector>
+#include <memory>
+#include <new>
+#include <thread>
 
 extern "C" {
 #include "../deps/soundpipe/h/base.h"
-#include "../deps/soundpipe/h/ftbl.h"
-#include "../deps/soundpipe/h/osc.h"
-#include "../deps/soundpipe/h/adsr.h"
-#include "../deps/soundpipe/h/moogladder.h"
-#include "../deps/soundpipe/h/fosc.h"
 }
 
 #include "wavetable_synth.h"
+#include "arena.h"
+#include "wavetable_bank.h"
+#include "voice_dsp.h"
+#include "fm_dsp.h"
+#include "params.h"
+#include "event_queue.h"
+#include "synth_patch.h"
+#include "synth_stats.h"
+#include "worker_pool.h"
 
-// Minimal Soundpipe state for a single-voice wavetable synth
 namespace {
-    sp_data* g_sp = nullptr;
-    sp_ftbl* g_ft1 = nullptr;
-    sp_ftbl* g_ft2 = nullptr;
-    int g_table_size = 2048;
-    float g_master_amp = 0.4f;
-    float g_env_atk = 0.01f, g_env_dec = 0.1f, g_env_sus = 0.8f, g_env_rel = 0.2f;
+    // Block engine: voices are rendered SIMD_WIDTH at a time, one module at a time over a block
+    constexpr int BLOCK_FRAMES = 64;   // internal processing block
+    constexpr int CONTROL_FRAMES = 16; // LFO/routing update period (samples)
+    constexpr int W = SIMD_WIDTH;
+    constexpr int MAX_GROUPS = MAX_VOICES / W;
+    constexpr int VOICE_MASK_WORDS = MAX_VOICES / 64;
+    constexpr float STEAL_FADE_MS = 3.0f; // fade-out of a stolen voice before its new note
+    constexpr int WAVE_FM = 4;
+    constexpr int WAVE_USER_BASE = 8;       // wave numbers of user tables: 8..8+MAX_USER_TABLES-1
+    constexpr int MAX_USER_TABLES = 8;
+    constexpr int MAX_USER_FRAMES = 256;
+    constexpr int MAX_OUT_CHANNELS = 32; // synth_render_planar
+    constexpr int MAX_UNISON = 16;       // copies per oscillator stack (synth_unison)
+    constexpr int MOD_LFOS = 3;
+    constexpr int LFO_TABLE_SIZE = 2048; // sine samples, plus a guard repeating the first
+#ifdef SYNTH_NO_THREADS
+    constexpr int MAX_RENDER_THREADS = 1;
+#else
+    constexpr int MAX_RENDER_THREADS = 16; // synth_set_threads; one GroupScratch each
+#endif
+    constexpr int MOD_GLOBAL_SOURCES = SYNTH_MOD_AMP_ENV; // sources below are shared by all voices
+    // Destinations a per-voice source can reach (lane values in group_block)
+    constexpr uint32_t MOD_VOICE_DESTS = 1u << SYNTH_MOD_PITCH | 1u << SYNTH_MOD_CUTOFF | 1u << SYNTH_MOD_AMP |
+                                         1u << SYNTH_MOD_GAIN1 | 1u << SYNTH_MOD_GAIN2;
 
-    // Filter parameters (applied per-voice; each voice has its own filter + env)
-    float g_fcut = 1200.0f;  // Hz
-    float g_fres = 0.3f;     // 0..1
-    float g_fenv_atk = 0.005f, g_fenv_dec = 0.15f, g_fenv_sus = 0.0f, g_fenv_rel = 0.25f;
-    float g_fenv_amt = 2000.0f; // Hz added to cutoff when filter env=1
-
-    // Master pitch LFO (sine)
-    sp_ftbl* g_lfo_ft = nullptr;
-    sp_osc*  g_lfo = nullptr;
-    float g_lfo_rate = 5.0f;      // Hz
-    float g_lfo_amt_semi = 0.0f;  // semitones peak (±)
-    // Flexible LFO routing
-    int   g_lfo_dest = 0;         // 0=pitch,1=cutoff,2=masterAmp,3=res,4=osc1Gain,5=osc2Gain,6=fm1Index,7=fm2Index
-    float g_lfo_amt = 0.0f;       // generic amount; units depend on destination
-
-    int g_wave1 = 0;
-    int g_wave2 = 0;
-    float g_detune1 = 0.0f;
-    float g_detune2 = 0.0f;
-    float g_gain1 = 0.5f;
-    float g_gain2 = 0.5f;
-    // FM defaults per oscillator
-    float g_fm1_car = 1.0f, g_fm1_mod = 1.0f, g_fm1_indx = 2.0f;
-    float g_fm2_car = 1.0f, g_fm2_mod = 1.0f, g_fm2_indx = 2.0f;
+    // Per-voice filter modes (synth_filter_mode)
+    enum FilterMode {
+        FILTER_LADDER = 0,  // Huovilainen ladder, 2x oversampled, per-sample tuning
+        FILTER_ZDF = 1,     // ZDF ladder, control-rate coefficients
+        FILTER_ZDF_2X = 2,  // ZDF ladder, 2x oversampled
+        FILTER_SVF = 3,     // ZDF state-variable, 12 dB/oct
+        FILTER_MODES
+    };
+
+    // CPU governor quality levels; each keeps the savings of the ones before
+    enum Quality {
+        QUALITY_FULL = 0,
+        QUALITY_CULL = 1,     // fade out releasing voices below the audibility threshold
+        QUALITY_CONTROL = 2,  // control signals once per block instead of every CONTROL_FRAMES
+        QUALITY_FILTER = 3,   // filter without oversampling
+        QUALITY_POLY = 4,     // polyphony capped
+        QUALITY_LEVELS
+    };
+    constexpr float GOV_LOAD_SMOOTH_S = 0.05f; // load averaging for the governor
+    constexpr float GOV_STEP_HOLD_S = 0.1f;    // wait between steps down in quality
+    constexpr float GOV_RECOVER_S = 1.0f;      // calm needed before stepping back up
+}
+
+// Engine instance. Everything a synth needs lives here, so any number of
+// independent engines can run in one module; only the built-in mip tables are
+// shared (read-only, see mip_builtin). synth_create carves the Synth, the
+// render scratch and the LFO table from one arena (engine_layout), so nothing
+// after creation allocates except user wavetables.
+struct Synth {
+    // Oscillator shape: 0..3 built-in wavetable, 4 = FM (fm_dsp.h), WAVE_USER_BASE + slot =
+    // user wavetable. Switching only swaps
+    // the index; the previous shape keeps sounding for a short crossfade.
+    struct OscShape {
+        int wave = 0;
+        int from = -1;       // shape being faded out, -1 = none
+        int fade_pos = 0;
+        int fade_len = 0;
+        bool fading = false; // crossfade runs during the current block
+    };
 
+    // Per-voice bookkeeping; the DSP state lives in the SoA banks below
     struct Voice {
-        sp_osc* osc1 = nullptr;
-        sp_osc* osc2 = nullptr;
-        sp_fosc* fosc1 = nullptr;
-        sp_fosc* fosc2 = nullptr;
-        sp_adsr* env = nullptr;
-        sp_moogladder* vcf = nullptr;
-        sp_adsr* fenv = nullptr;
         int midi = -1;
         float base_hz = 440.0f;
         float vel = 0.0f;
         float gate = 0.0f; // 1 = on, 0 = off
         bool active = false;
+        int pending_midi = -1;    // note waiting for this voice's steal fade, -1 = none
+        float pending_vel = 0.0f;
+        uint32_t age = 0;         // note-on order, for stealing the oldest
+        float spread_pos = 0.0f;  // place across the stereo spread (-1..1), set at note-on
+        float pan = 0.0f;         // pan the channel gains below were computed for
+        float pan_gain[2] = {1.0f, 1.0f}; // left/right weights reached at the end of the last block
+    };
+
+    // Unison stack of one oscillator (synth_unison): detuned copies of its
+    // wavetable sharing the voice's filter and envelopes
+    struct Unison {
+        int voices = 1;       // copies, 1 = off
+        float detune = 0.2f;  // semitones from the centre to the outermost copies
+        float curve = 0.0f;   // 0 = even spacing .. 1 = copies gathered near the centre
+        float width = 0.0f;   // stereo spread of the copies, 0..1
+        float random = 0.0f;  // note-on phase randomness, 0 = the same offsets every note
+        // Derived by unison_layout
+        float ratio[MAX_UNISON] = {1.0f};  // frequency multiplier, ascending
+        float pan[MAX_UNISON] = {};        // stereo position, -1..1
+        float offset[MAX_UNISON] = {};     // fixed start phase
+        float gain = 1.0f;                 // 1/sqrt(voices)
+    };
+
+    int sr = 0; // sample rate, 0 until synth_init
+    int table_size = 2048;
+    // Band-limited mip tables for every built-in shape, looked up in synth_init
+    const MipTable* tables[WAVE_SHAPE_COUNT] = {};
+    // Pending timestamped events and the engine clock they are scheduled against
+    EventQueue events;
+    uint32_t frame = 0;
+    // Patches from synth_load_state, applied at the start of a render call
+    PatchMailbox patches;
+
+    // Continuous parameters are smoothed over smooth_ms (see params.h)
+    float smooth_ms = 10.0f;
+    SmoothedParam master_amp{0.4f};
+    EnvParams env_params{0.01f, 0.1f, 0.8f, 0.2f};
+
+    // Filter parameters (applied per-voice; each voice has its own filter + env)
+    SmoothedParam fcut{1200.0f};  // Hz
+    SmoothedParam fres{0.3f};     // 0..1
+    bool  filter_on = true;
+    int   filter_mode = FILTER_LADDER; // synth_filter_mode
+    EnvParams fenv_params{0.005f, 0.15f, 0.0f, 0.25f};
+    SmoothedParam fenv_amt{2000.0f}; // Hz added to cutoff when filter env=1
+
+    // Modulation LFOs, evaluated at control rate and ramped per sample. LFO 1
+    // is the classic LFO routed by lfo_dest below.
+    struct Lfo {
+        float rate = 5.0f;  // Hz
+        int shape = SYNTH_LFO_SINE;
+        float phase = 0.0f; // 0..1
+        float last = 0.0f;  // value at the end of the previous control period
+    };
+    const float* lfo_sine = nullptr; // LFO_TABLE_SIZE + 1 samples (arena)
+    Lfo lfo[MOD_LFOS];
+    float lfo_amt_semi = 0.0f;  // semitones peak (±)
+    // Flexible LFO routing
+    int   lfo_dest = 0;         // 0=pitch,1=cutoff,2=masterAmp,3=res,4=osc1Gain,5=osc2Gain,6=fm1Index,7=fm2Index,
+                                // 8=osc1Position,9=osc2Position
+    float lfo_amt = 0.0f;       // generic amount; units depend on destination
+    SmoothedParam lfo_depth;    // effective amount for the current destination
+
+    // Modulation matrix (synth_mod_route). The slots are compiled when they
+    // change into flat lists of the active routes, global and per-voice apart.
+    struct ModRoute {
+        int source = -1; // SynthModSource, -1 = empty
+        int dest = 0;    // SynthModDest
+        float amount = 0.0f;
+    };
+    ModRoute routes[SYNTH_MOD_ROUTES];
+    bool routes_changed = false;
+    ModRoute global_routes[SYNTH_MOD_ROUTES];
+    int global_route_count = 0;
+    ModRoute voice_routes[SYNTH_MOD_ROUTES];
+    int voice_route_count = 0;
+    uint32_t voice_dests = 0;     // destinations with per-voice routes, one bit each
+    bool lfo_used[MOD_LFOS] = {}; // LFOs read by a route this block
+    SmoothedParam mod_wheel{0.0f};
+
+    OscShape osc1, osc2;
+    float wave_fade_ms = 5.0f;
+    float detune1 = 0.0f;          // semitones
+    float detune2 = 0.0f;
+    SmoothedParam det1_ratio{1.0f}; // 2^(detune/12), computed by the setter
+    SmoothedParam det2_ratio{1.0f};
+    SmoothedParam gain1{0.5f};
+    SmoothedParam gain2{0.5f};
+    // FM patch per oscillator; the index scales every modulator
+    FmPatch fm_patch[2];
+    SmoothedParam fm1_indx{2.0f};
+    SmoothedParam fm2_indx{2.0f};
+    SmoothedParam pos1{0.0f}; // position across the frames of a user table (0..1)
+    SmoothedParam pos2{0.0f};
+    // Stereo placement for planar output: every voice sits at pan + spread * its
+    // spread_pos. Mono output ignores both.
+    float pan = 0.0f;
+    float spread = 0.0f;
+    Unison unison[2];
+    uint32_t unison_rng = 0x2545f491u; // note-on phase randomness (xorshift)
+
+    // User wavetables over host memory; each builds its mip levels on its own
+    // thread, or where there are no threads one step of one table per render
+    struct UserTable {
+        std::unique_ptr<FrameTable> table;
+        std::thread builder;
+    };
+    UserTable user_tables[MAX_USER_TABLES];
+    int build_next = 0; // slot the next render's build step starts looking at
+
+    int poly_n = 8;
+    Voice voices[MAX_VOICES];
+    // Voices in use (active), one bit per voice. Allocation takes the lowest
+    // free slot, so sounding voices stay packed into few SIMD groups, and
+    // rendering visits only groups with a bit set.
+    uint64_t voice_used[VOICE_MASK_WORDS] = {};
+    uint32_t note_count = 0;
+
+    // Structure-of-arrays voice state, one lane per voice (see voice_dsp.h)
+    VOICE_ALIGN float phase1[MAX_VOICES]; // wavetable oscillator phases (0..1)
+    VOICE_ALIGN float phase2[MAX_VOICES];
+    VOICE_ALIGN float phase_fade[MAX_VOICES]; // phase copy for the shape being faded out
+    VOICE_ALIGN float uphase[2][MAX_UNISON][MAX_VOICES]; // unison copy phases of each oscillator
+    VOICE_ALIGN float uphase_fade[MAX_UNISON][MAX_VOICES];
+    VOICE_ALIGN float steal_gain[MAX_VOICES]; // fade-out of a stolen voice, 1 = none
+    VOICE_ALIGN float steal_step[MAX_VOICES]; // per-sample change of steal_gain while fading
+    EnvState env;     // amplitude envelopes
+    EnvState fenv;    // filter envelopes
+    LadderState vcf;  // ladder filters
+    ZdfState zdf;     // ZDF ladder / SVF filters
+    LadderState vcf_side; // the same filters on the side signal of wide unison
+    ZdfState zdf_side;
+    FmState fm[2];    // FM operators of each oscillator
+
+    // Per-block control signals shared by all voices: smoothed parameters with
+    // the LFO applied to its destination, already clamped to their ranges
+    float lfo_buf[MOD_LFOS][BLOCK_FRAMES]; // LFO value ramps (-1..1)
+    float wheel_buf[BLOCK_FRAMES];
+    float mod_buf[BLOCK_FRAMES];    // LFO depth * LFO value
+    float mod_sum[SYNTH_MOD_DESTS][BLOCK_FRAMES]; // global modulation per destination
+    float pitch1_buf[BLOCK_FRAMES]; // osc1 frequency multiplier (detune * pitch LFO)
+    float pitch2_buf[BLOCK_FRAMES];
+    float gain1_buf[BLOCK_FRAMES];
+    float gain2_buf[BLOCK_FRAMES];
+    float fm1_idx_buf[BLOCK_FRAMES];
+    float fm2_idx_buf[BLOCK_FRAMES];
+    float cutoff_buf[BLOCK_FRAMES]; // base cutoff (Hz) before the filter envelope
+    float fenv_amt_buf[BLOCK_FRAMES];
+    float res_buf[BLOCK_FRAMES];
+    float amp_buf[BLOCK_FRAMES];    // master amplitude
+    float fade1_buf[BLOCK_FRAMES];  // weight of the new osc1 shape during a switch
+    float fade2_buf[BLOCK_FRAMES];
+    float pos1_buf[BLOCK_FRAMES];   // user table position
+    float pos2_buf[BLOCK_FRAMES];
+    VOICE_ALIGN float live[MAX_VOICES]; // 1 for voices rendered this block
+    int group_list[MAX_GROUPS]; // groups with a live voice this block, ascending
+    int group_count = 0;
+    // Rendered output of each voice group for the block, summed in voice order
+    // afterwards, so the mix does not depend on which thread rendered what
+    VOICE_ALIGN float group_out[MAX_GROUPS][BLOCK_FRAMES * W];
+    // Side signal of each group when unison copies are spread in stereo
+    // (left = out - side, right = out + side)
+    VOICE_ALIGN float group_side[MAX_GROUPS][BLOCK_FRAMES * W];
+    bool wide = false; // group_side is rendered this block
+    float mix_buf[2][BLOCK_FRAMES]; // block mix: mono in [0], or left/right
+
+    // Per-group lane buffers, sample-major: buf[i * W + lane]. One set per
+    // render thread.
+    struct GroupScratch {
+        VOICE_ALIGN float osc1_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float osc2_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float voice_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float fenv_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float env_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float cut_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float osc1_side[BLOCK_FRAMES * W]; // side signals, with Synth::wide
+        VOICE_ALIGN float osc2_side[BLOCK_FRAMES * W];
+        VOICE_ALIGN float side_buf[BLOCK_FRAMES * W];
+        VOICE_ALIGN float voice_mod[SYNTH_MOD_DESTS][W]; // per-voice routes, per lane, for the block
+    };
+    GroupScratch* scratch = nullptr; // MAX_RENDER_THREADS sets (arena)
+
+    // Parallel voice rendering (synth_set_threads)
+    int threads = 1;
+    int min_voices_per_thread = 8;
+
+    // CPU governor (synth_set_governor)
+    bool gov_on = false;
+    float gov_degrade = 0.85f;  // smoothed load that steps quality down
+    float gov_recover = 0.5f;   // load below which quality steps back up
+    float gov_cull = 0.001f;    // QUALITY_CULL threshold (-60 dB, envelope * velocity)
+    int gov_min_poly = 8;       // QUALITY_POLY keeps at least this many voices
+    float gov_load = 0.0f;      // load smoothed over GOV_LOAD_SMOOTH_S
+    float gov_hold = 0.0f;      // seconds until quality may drop another level
+    float gov_calm = 0.0f;      // seconds the load has stayed below gov_recover
+    int quality = QUALITY_FULL;
+    int control_frames = CONTROL_FRAMES;
+
+    // Telemetry (synth_stats.h), plus the level of the render call in progress
+    SynthStats stats;
+    float call_peak = 0.0f;
+    float call_sumsq = 0.0f;
+
+    std::size_t arena_bytes = 0; // the block this Synth heads (engine_layout)
+};
+
+namespace {
+    using Voice = Synth::Voice;
+    using OscShape = Synth::OscShape;
+    using GroupScratch = Synth::GroupScratch;
+
+    // Everything an engine owns, in one arena: the Synth first (its SoA voice
+    // state and block buffers are cache-line aligned members), then the group
+    // scratch of each render thread and the LFO sine. Run on an empty Arena to
+    // size the block, then on the block to place it.
+    struct EngineLayout {
+        Synth* synth;
+        GroupScratch* scratch;
+        float* lfo_sine;
     };
 
-    constexpr int MAX_VOICES = 16;
-    int g_poly_n = 8;
-    Voice g_voices[MAX_VOICES];
-    int g_voice_rr = 0; // round-robin index for stealing
-
-    void ensure_sp() {
-        if (!g_sp) {
-            sp_create(&g_sp);
-        }
-    }
-
-    void rebuild_table_sine(sp_ftbl** pft) {
-        if (!g_sp) return;
-        if (!*pft) sp_ftbl_create(g_sp, pft, g_table_size);
-        sp_gen_sine(g_sp, *pft);
-    }
-
-    // Build a harmonic series string like: "1 0.5 0.3333 ..." up to N partials
-    std::string harmonic_series(unsigned int partials, bool odd_only, bool square) {
-        std::string s;
-        s.reserve(partials * 6);
-        for (unsigned int n = 1, added = 0; added < partials; ++n) {
-            if (odd_only && (n % 2 == 0)) continue; // skip even harmonics for square
-            float amp = square ? (1.0f / static_cast<float>(n)) : (1.0f / static_cast<float>(n));
-            // For saw: 1/n; for square (odd only): 1/n as well; sign handled by table phase
-            // Note: Soundpipe sinesum accepts positive amplitudes.
-            char buf[32];
-            std::snprintf(buf, sizeof(buf), "%g ", amp);
-            s += buf;
-            ++added;
-        }
-        if (!s.empty()) s.pop_back(); // remove trailing space
-        return s;
-    }
-
-    void rebuild_table_saw(sp_ftbl** pft, unsigned int partials = 32) {
-        if (!g_sp) return;
-        if (!*pft) sp_ftbl_create(g_sp, pft, g_table_size);
-        auto coeffs = harmonic_series(partials, /*odd_only*/false, /*square*/false);
-        sp_gen_sinesum(g_sp, *pft, coeffs.c_str());
-    }
-
-    void rebuild_table_square(sp_ftbl** pft, unsigned int partials = 32) {
-        if (!g_sp) return;
-        if (!*pft) sp_ftbl_create(g_sp, pft, g_table_size);
-        auto coeffs = harmonic_series(partials, /*odd_only*/true, /*square*/true);
-        sp_gen_sinesum(g_sp, *pft, coeffs.c_str());
-    }
-
-    void rebuild_table_triangle(sp_ftbl** pft) {
-        if (!g_sp) return;
-        if (!*pft) sp_ftbl_create(g_sp, pft, g_table_size);
-        sp_gen_triangle(g_sp, *pft);
-    }
-
-    void init_voices_if_needed() {
-        if (!g_sp) return;
-        if (!g_ft1) rebuild_table_sine(&g_ft1);
-        if (!g_ft2) rebuild_table_sine(&g_ft2);
-        for (int i = 0; i < g_poly_n; ++i) {
-            if (!g_voices[i].osc1) {
-                sp_osc_create(&g_voices[i].osc1);
-                sp_osc_init(g_sp, g_voices[i].osc1, g_ft1, 0);
-                g_voices[i].osc1->amp = 1.0f;
-                g_voices[i].osc1->freq = 440.0f;
-            }
-            if (!g_voices[i].osc2) {
-                sp_osc_create(&g_voices[i].osc2);
-                sp_osc_init(g_sp, g_voices[i].osc2, g_ft2, 0);
-                g_voices[i].osc2->amp = 1.0f;
-                g_voices[i].osc2->freq = 440.0f;
-            }
-            if (!g_voices[i].env) {
-                sp_adsr_create(&g_voices[i].env);
-                sp_adsr_init(g_sp, g_voices[i].env);
-            }
-            if (!g_voices[i].vcf) {
-                sp_moogladder_create(&g_voices[i].vcf);
-                sp_moogladder_init(g_sp, g_voices[i].vcf);
-            }
-            if (!g_voices[i].fenv) {
-                sp_adsr_create(&g_voices[i].fenv);
-                sp_adsr_init(g_sp, g_voices[i].fenv);
-        }
-        // FM oscillators
-        if (!g_voices[i].fosc1) {
-            sp_fosc_create(&g_voices[i].fosc1);
-            // ensure sine ft exists for FM
-            if (!g_lfo_ft) { sp_ftbl_create(g_sp, &g_lfo_ft, 2048); sp_gen_sine(g_sp, g_lfo_ft); }
-            sp_fosc_init(g_sp, g_voices[i].fosc1, g_lfo_ft);
-            g_voices[i].fosc1->amp = 1.0f; g_voices[i].fosc1->freq = 440.0f;
-            g_voices[i].fosc1->car = g_fm1_car; g_voices[i].fosc1->mod = g_fm1_mod; g_voices[i].fosc1->indx = g_fm1_indx;
-        }
-        if (!g_voices[i].fosc2) {
-            sp_fosc_create(&g_voices[i].fosc2);
-            if (!g_lfo_ft) { sp_ftbl_create(g_sp, &g_lfo_ft, 2048); sp_gen_sine(g_sp, g_lfo_ft); }
-            sp_fosc_init(g_sp, g_voices[i].fosc2, g_lfo_ft);
-            g_voices[i].fosc2->amp = 1.0f; g_voices[i].fosc2->freq = 440.0f;
-            g_voices[i].fosc2->car = g_fm2_car; g_voices[i].fosc2->mod = g_fm2_mod; g_voices[i].fosc2->indx = g_fm2_indx;
-        }
-        // Sync env params
-        g_voices[i].env->atk = g_env_atk;
-        g_voices[i].env->dec = g_env_dec;
-        g_voices[i].env->sus = g_env_sus;
-        g_voices[i].env->rel = g_env_rel;
-        // Sync filter params
-        g_voices[i].vcf->freq = g_fcut;
-        g_voices[i].vcf->res = g_fres;
-        g_voices[i].fenv->atk = g_fenv_atk;
-        g_voices[i].fenv->dec = g_fenv_dec;
-        g_voices[i].fenv->sus = g_fenv_sus;
-        g_voices[i].fenv->rel = g_fenv_rel;
-    }
-    // LFO init
-    if (!g_lfo_ft) sp_ftbl_create(g_sp, &g_lfo_ft, 2048), sp_gen_sine(g_sp, g_lfo_ft);
-    if (!g_lfo) { sp_osc_create(&g_lfo); sp_osc_init(g_sp, g_lfo, g_lfo_ft, 0); g_lfo->amp = 1.0f; }
-    g_lfo->freq = g_lfo_rate;
-    }
-
-    void free_all_voices() {
-        for (int i = 0; i < MAX_VOICES; ++i) {
-            if (g_voices[i].osc1) { sp_osc_destroy(&g_voices[i].osc1); }
-            if (g_voices[i].osc2) { sp_osc_destroy(&g_voices[i].osc2); }
-            if (g_voices[i].env) { sp_adsr_destroy(&g_voices[i].env); }
-            if (g_voices[i].vcf) { sp_moogladder_destroy(&g_voices[i].vcf); }
-            if (g_voices[i].fenv) { sp_adsr_destroy(&g_voices[i].fenv); }
-            if (g_voices[i].fosc1) { sp_fosc_destroy(&g_voices[i].fosc1); }
-            if (g_voices[i].fosc2) { sp_fosc_destroy(&g_voices[i].fosc2); }
-            g_voices[i] = Voice{};
-        }
-    }
-
-    int find_free_voice() {
-        for (int i = 0; i < g_poly_n; ++i) {
-            if (!g_voices[i].active && g_voices[i].gate <= 0.0f) return i;
-        }
-        // steal round robin
-        int idx = g_voice_rr++ % g_poly_n;
-        return idx;
+    EngineLayout engine_layout(Arena& a) {
+        EngineLayout l;
+        l.synth = a.carve<Synth>();
+        l.scratch = a.carve<GroupScratch>(MAX_RENDER_THREADS);
+        l.lfo_sine = a.carve<float>(LFO_TABLE_SIZE + 1);
+        return l;
+    }
+
+    void build_tables(Synth& s) {
+        for (int w = 0; w < WAVE_SHAPE_COUNT; ++w) s.tables[w] = &mip_builtin(w, s.table_size);
+    }
+
+    // Stop a user table's builder and drop it; oscillators on it fall back to sine
+    void release_user_table(Synth& s, int slot) {
+        Synth::UserTable& ut = s.user_tables[slot];
+        if (!ut.table) return;
+        ut.table->cancel.store(true);
+        if (ut.builder.joinable()) ut.builder.join();
+        ut.table.reset();
+    }
+
+    const FrameTable* user_table(const Synth& s, int wave) {
+        int slot = wave - WAVE_USER_BASE;
+        if (slot < 0 || slot >= MAX_USER_TABLES) return nullptr;
+        return s.user_tables[slot].table.get();
+    }
+
+    void free_all_voices(Synth& s) {
+        for (int i = 0; i < MAX_VOICES; ++i) s.voices[i] = Voice{};
+        std::memset(s.voice_used, 0, sizeof(s.voice_used));
+        s.note_count = 0;
+        for (int i = 0; i < MAX_VOICES; ++i) s.steal_gain[i] = 1.0f;
+        std::memset(s.steal_step, 0, sizeof(s.steal_step));
+        std::memset(s.phase1, 0, sizeof(s.phase1));
+        std::memset(s.phase2, 0, sizeof(s.phase2));
+        std::memset(s.uphase, 0, sizeof(s.uphase));
+        s.osc1.from = s.osc2.from = -1;
+        env_reset(s.env);
+        env_reset(s.fenv);
+        ladder_reset(s.vcf);
+        zdf_reset(s.zdf);
+        ladder_reset(s.vcf_side);
+        zdf_reset(s.zdf_side);
+        for (FmState& f : s.fm) fm_reset(f);
+    }
+
+    inline bool voice_in_use(const Synth& s, int v) { return (s.voice_used[v >> 6] >> (v & 63)) & 1u; }
+
+    // First voice in use at or after v, or MAX_VOICES
+    int next_used_voice(const Synth& s, int v) {
+        for (int w = v >> 6; w < VOICE_MASK_WORDS; ++w) {
+            uint64_t bits = s.voice_used[w];
+            if (w == v >> 6) bits &= ~0ull << (v & 63);
+            if (bits) return w * 64 + __builtin_ctzll(bits);
+        }
+        return MAX_VOICES;
+    }
+
+    // Voices notes may use: poly_n, or less once the governor caps polyphony
+    int voice_limit(const Synth& s) {
+        if (s.quality < QUALITY_POLY) return s.poly_n;
+        int cap = s.poly_n / 2 > s.gov_min_poly ? s.poly_n / 2 : s.gov_min_poly;
+        return cap < s.poly_n ? cap : s.poly_n;
+    }
+
+    // Lowest free slot below the voice limit, or -1
+    int find_free_voice(const Synth& s) {
+        int n = voice_limit(s);
+        for (int w = 0; w * 64 < n; ++w) {
+            int limit = n - w * 64;
+            uint64_t bits = ~s.voice_used[w];
+            if (limit < 64) bits &= (1ull << limit) - 1;
+            if (bits) return w * 64 + __builtin_ctzll(bits);
+        }
+        return -1;
+    }
+
+    float voice_pan(const Synth& s, const Voice& vc) {
+        float p = s.pan + s.spread * vc.spread_pos;
+        return p < -1.0f ? -1.0f : (p > 1.0f ? 1.0f : p);
+    }
+
+    // Equal-power pan law scaled so the centre is unity on both channels
+    // (stereo output of a centred patch matches the mono render)
+    void pan_gains(float pan, float* gain) {
+        double a = (pan + 1.0) * (M_PI / 4.0);
+        gain[0] = (float)(std::cos(a) * M_SQRT2);
+        gain[1] = (float)(std::sin(a) * M_SQRT2);
+    }
+
+    // Uniform 0..1 from the engine's own generator, so renders repeat exactly
+    float unison_random(Synth& s) {
+        uint32_t x = s.unison_rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        s.unison_rng = x;
+        return (float)(x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void start_voice(Synth& s, int v, int midi, float vel) {
+        Voice& vc = s.voices[v];
+        vc.base_hz = sp_midi2cps(static_cast<float>(midi));
+        vc.midi = midi;
+        vc.vel = vel;
+        vc.gate = 1.0f;
+        vc.active = true;
+        vc.pending_midi = -1;
+        vc.age = s.note_count++;
+        // Successive notes spread out along a low-discrepancy sequence, so any
+        // run of them covers the field evenly
+        float t = (float)vc.age * 0.618034f;
+        vc.spread_pos = 2.0f * (t - std::floor(t)) - 1.0f;
+        vc.pan = voice_pan(s, vc);
+        pan_gains(vc.pan, vc.pan_gain);
+        // Unison copies start at their fixed offsets, scattered by the randomness
+        for (int o = 0; o < 2; ++o) {
+            const Synth::Unison& u = s.unison[o];
+            if (u.voices < 2) continue;
+            for (int c = 0; c < u.voices; ++c) {
+                float p = u.offset[c] + (u.random > 0.0f ? u.random * unison_random(s) : 0.0f);
+                s.uphase[o][c][v] = p - std::floor(p);
+            }
+        }
+        for (FmState& f : s.fm) fm_reset_voice(f, v);
+        s.voice_used[v >> 6] |= 1ull << (v & 63);
+    }
+
+    void free_voice(Synth& s, int v) {
+        Voice& vc = s.voices[v];
+        vc.active = false;
+        vc.gate = 0.f;
+        vc.midi = -1;
+        vc.vel = 0.f;
+        vc.pending_midi = -1;
+        s.steal_gain[v] = 1.0f;
+        s.steal_step[v] = 0.0f;
+        s.voice_used[v >> 6] &= ~(1ull << (v & 63));
+    }
+
+    // Stealing order: voices not already being stolen, then released ones,
+    // then the quietest, then the oldest
+    bool steal_before(const Synth& s, int a, int b) {
+        const Voice& va = s.voices[a];
+        const Voice& vb = s.voices[b];
+        bool fa = s.steal_step[a] != 0.0f, fb = s.steal_step[b] != 0.0f;
+        if (fa != fb) return fb;
+        bool ra = va.gate <= 0.f, rb = vb.gate <= 0.f;
+        if (ra != rb) return ra;
+        float la = s.env.y[a] * va.vel, lb = s.env.y[b] * vb.vel;
+        if (la != lb) return la < lb;
+        return (int32_t)(va.age - vb.age) < 0;
+    }
+
+    // Start the short fade that ends a stolen or culled voice
+    void fade_out_voice(Synth& s, int v) {
+        int len = (int)(STEAL_FADE_MS * 0.001f * (float)s.sr);
+        s.steal_step[v] = -1.0f / (float)(len > 0 ? len : 1);
+        s.voices[v].gate = 0.0f;
+    }
+
+    // All voices busy: release the victim with a short fade-out and hand it
+    // the new note, which starts once the fade ends (see render_segment).
+    // Stealing a voice that is already fading just replaces its pending note.
+    void steal_voice(Synth& s, int midi, float vel) {
+        int v = 0;
+        for (int i = 1, n = voice_limit(s); i < n; ++i) if (steal_before(s, i, v)) v = i;
+        Voice& vc = s.voices[v];
+        if (s.steal_step[v] == 0.0f) fade_out_voice(s, v);
+        vc.pending_midi = midi;
+        vc.pending_vel = vel;
+        s.stats.steals.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline float clampf(float x, float lo, float hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+    int ramp_samples(Synth& s) {
+        return s.sr ? (int)(s.smooth_ms * 0.001f * (float)s.sr) : 0;
+    }
+
+    // Effective LFO amount for the current destination
+    float lfo_depth_target(Synth& s) {
+        if (s.lfo_dest == 0) return s.lfo_amt != 0.0f ? s.lfo_amt : s.lfo_amt_semi;
+        return s.lfo_amt;
+    }
+
+    float lfo_value(const Synth& s, int shape, float phase) {
+        switch (shape) {
+            case SYNTH_LFO_TRIANGLE: {
+                float t = phase + 0.75f;
+                return 4.0f * std::fabs(t - floorf(t) - 0.5f) - 1.0f;
+            }
+            case SYNTH_LFO_SAW: return 2.0f * phase - 1.0f;
+            case SYNTH_LFO_SQUARE: return phase < 0.5f ? 1.0f : -1.0f;
+            default: {
+                const float* tbl = s.lfo_sine;
+                float idx = phase * (float)LFO_TABLE_SIZE;
+                int i0 = (int)idx;
+                return tbl[i0] + (tbl[i0 + 1] - tbl[i0]) * (idx - (float)i0);
+            }
+        }
+    }
+
+    // Advance the LFOs by n samples, evaluating each once per control period
+    // and linearly ramping between control points into s.lfo_buf. LFOs no
+    // route reads keep their phase but skip the ramp.
+    void lfo_block(Synth& s, int n) {
+        for (int l = 0; l < MOD_LFOS; ++l) {
+            Synth::Lfo& o = s.lfo[l];
+            float inc = o.rate / (float)s.sr;
+            float* buf = s.lfo_buf[l];
+            for (int i = 0; i < n; i += s.control_frames) {
+                int len = n - i < s.control_frames ? n - i : s.control_frames;
+                o.phase += inc * (float)len;
+                o.phase -= floorf(o.phase);
+                float target = lfo_value(s, o.shape, o.phase);
+                if (s.lfo_used[l]) {
+                    float step = (target - o.last) / (float)len;
+                    for (int k = 0; k < len; ++k) buf[i + k] = o.last + step * (float)(k + 1);
+                }
+                o.last = target;
+            }
+        }
+    }
+
+    // Flatten the route slots into the active global and per-voice lists
+    void compile_routes(Synth& s) {
+        s.global_route_count = s.voice_route_count = 0;
+        s.voice_dests = 0;
+        for (const Synth::ModRoute& r : s.routes) {
+            if (r.source < 0 || r.amount == 0.0f) continue;
+            if (r.source < MOD_GLOBAL_SOURCES) {
+                s.global_routes[s.global_route_count++] = r;
+            } else if (MOD_VOICE_DESTS >> r.dest & 1u) {
+                s.voice_routes[s.voice_route_count++] = r;
+                s.voice_dests |= 1u << r.dest;
+            }
+        }
+        s.routes_changed = false;
+    }
+
+    // Global routes into s.mod_sum, on top of the classic LFO; mod[d] is the
+    // modulation of destination d for the block, or nullptr for none
+    void mod_block(Synth& s, const float** mod, int n) {
+        for (int k = 0; k < s.global_route_count; ++k) {
+            const Synth::ModRoute& r = s.global_routes[k];
+            const float* src = r.source == SYNTH_MOD_WHEEL ? s.wheel_buf : s.lfo_buf[r.source];
+            float* sum = s.mod_sum[r.dest];
+            if (mod[r.dest] != sum) {
+                if (mod[r.dest]) std::memcpy(sum, mod[r.dest], sizeof(float) * n);
+                else std::memset(sum, 0, sizeof(float) * n);
+                mod[r.dest] = sum;
+            }
+            for (int i = 0; i < n; ++i) sum[i] += r.amount * src[i];
+        }
+    }
+
+    inline void add_clamped(float* dst, const float* mod, float lo, float hi, int n) {
+        for (int i = 0; i < n; ++i) dst[i] = clampf(dst[i] + (mod ? mod[i] : 0.f), lo, hi);
+    }
+
+    // Weight of the new shape over the block while a shape switch crossfades
+    void fade_block(OscShape& o, float* w, int n) {
+        o.fading = o.from >= 0;
+        if (!o.fading) return;
+        for (int i = 0; i < n; ++i) {
+            if (o.fade_pos < o.fade_len) ++o.fade_pos;
+            w[i] = (float)o.fade_pos / (float)o.fade_len;
+        }
+        if (o.fade_pos >= o.fade_len) o.from = -1; // finished; still blended this block
+    }
+
+    void switch_shape(Synth& s, OscShape& o, int wave) {
+        if (wave == o.wave) return;
+        int len = s.sr ? (int)(s.wave_fade_ms * 0.001f * (float)s.sr) : 0;
+        if (next_used_voice(s, 0) == MAX_VOICES) len = 0; // nothing sounding
+        // A switch during a fade restarts it from the shape currently selected
+        o.from = len > 0 ? o.wave : -1;
+        o.fade_pos = 0;
+        o.fade_len = len;
+        o.wave = wave;
+    }
+
+    // Detune ratio, stereo position and start phase of every copy of a stack.
+    // Copies sit evenly across -1..1, drawn towards the centre by the curve.
+    // Mirror pairs take opposite sides, alternating inwards, so neighbouring
+    // pitches split up and the stack stays balanced.
+    void unison_layout(Synth::Unison& u) {
+        float e = 1.0f + 3.0f * u.curve;
+        for (int c = 0; c < u.voices; ++c) {
+            float x = u.voices > 1 ? 2.0f * (float)c / (float)(u.voices - 1) - 1.0f : 0.0f;
+            float d = std::copysign(std::pow(std::fabs(x), e), x);
+            int edge = c < u.voices - 1 - c ? c : u.voices - 1 - c;
+            u.ratio[c] = std::pow(2.0f, u.detune * d / 12.0f);
+            u.pan[c] = u.width * ((edge & 1) ? -x : x);
+            float t = (float)c * 0.618034f;
+            u.offset[c] = t - std::floor(t);
+        }
+        u.gain = 1.0f / std::sqrt((float)u.voices);
+    }
+
+    // Control stage: advance every smoothed parameter and the LFO over the block
+    // and fold the LFO into its destination. Runs once per block for all voices.
+    void control_block(Synth& s, int n) {
+        if (s.routes_changed) compile_routes(s);
+        bool lfo_on = s.lfo_depth.value != 0.0f || s.lfo_depth.remaining > 0;
+        bool wheel = false;
+        for (bool& u : s.lfo_used) u = false;
+        s.lfo_used[0] = lfo_on;
+        for (int k = 0; k < s.global_route_count; ++k) {
+            int src = s.global_routes[k].source;
+            if (src == SYNTH_MOD_WHEEL) wheel = true;
+            else s.lfo_used[src] = true;
+        }
+        lfo_block(s, n);
+        if (wheel) s.mod_wheel.fill(s.wheel_buf, n);
+        else s.mod_wheel.advance(n);
+        const float* mod[SYNTH_MOD_DESTS] = {};
+        if (lfo_on && s.lfo_dest >= 0 && s.lfo_dest < SYNTH_MOD_DESTS) {
+            s.lfo_depth.fill(s.mod_buf, n);
+            for (int i = 0; i < n; ++i) s.mod_buf[i] *= s.lfo_buf[0][i];
+            mod[s.lfo_dest] = s.mod_buf;
+        } else {
+            s.lfo_depth.advance(n);
+        }
+        mod_block(s, mod, n);
+
+        s.det1_ratio.fill(s.pitch1_buf, n);
+        s.det2_ratio.fill(s.pitch2_buf, n);
+        if (const float* m0 = mod[SYNTH_MOD_PITCH]) { // semitones, per-sample fast exp2
+            for (int i = 0; i < n; ++i) {
+                float m = exp2_fast(m0[i] * (1.0f / 12.0f));
+                s.pitch1_buf[i] *= m;
+                s.pitch2_buf[i] *= m;
+            }
+        }
+        s.gain1.fill(s.gain1_buf, n);
+        add_clamped(s.gain1_buf, mod[SYNTH_MOD_GAIN1], 0.f, 2.f, n);
+        s.gain2.fill(s.gain2_buf, n);
+        add_clamped(s.gain2_buf, mod[SYNTH_MOD_GAIN2], 0.f, 2.f, n);
+        s.fm1_indx.fill(s.fm1_idx_buf, n);
+        add_clamped(s.fm1_idx_buf, mod[SYNTH_MOD_FM1_INDEX], 0.f, 1e9f, n);
+        s.fm2_indx.fill(s.fm2_idx_buf, n);
+        add_clamped(s.fm2_idx_buf, mod[SYNTH_MOD_FM2_INDEX], 0.f, 1e9f, n);
+        s.fcut.fill(s.cutoff_buf, n);
+        if (const float* m1 = mod[SYNTH_MOD_CUTOFF]) {
+            for (int i = 0; i < n; ++i) s.cutoff_buf[i] += m1[i]; // clamped after the env
+        }
+        s.fenv_amt.fill(s.fenv_amt_buf, n);
+        s.fres.fill(s.res_buf, n);
+        add_clamped(s.res_buf, mod[SYNTH_MOD_RES], 0.f, 1.f, n);
+        s.master_amp.fill(s.amp_buf, n);
+        add_clamped(s.amp_buf, mod[SYNTH_MOD_AMP], 0.f, 2.f, n);
+        s.pos1.fill(s.pos1_buf, n);
+        add_clamped(s.pos1_buf, mod[SYNTH_MOD_POSITION1], 0.f, 1.f, n);
+        s.pos2.fill(s.pos2_buf, n);
+        add_clamped(s.pos2_buf, mod[SYNTH_MOD_POSITION2], 0.f, 1.f, n);
+        fade_block(s.osc1, s.fade1_buf, n);
+        fade_block(s.osc2, s.fade2_buf, n);
+    }
+
+    // Wavetable oscillator for one voice group. The mip level pair is chosen per
+    // lane from its frequency once per control period and crossfaded so
+    // harmonics fade in/out smoothly; phases advance as one vector.
+    void wt_group(Synth& s, const MipTable& mt, float* phase, int v0, const float* hz, const float* pitch,
+                  float* dst, int n) {
+        vmask keep = v_load(s.live + v0) > 0.5f;
+        float inv_sr = 1.0f / (float)s.sr;
+        float size = (float)mt.size;
+        vfloat ph = v_load(phase + v0), vhz = v_load(hz);
+        const float* la[W];
+        const float* lb[W];
+        float t[W];
+        int32_t i0[W];
+        float a0[W], a1[W], b0[W], b1[W];
+        for (int i = 0; i < n; i += s.control_frames) {
+            int len = n - i < s.control_frames ? n - i : s.control_frames;
+            for (int l = 0; l < W; ++l) {
+                float f = hz[l] * pitch[i];
+                // Position one octave above the lowest alias-free level, so both
+                // blended levels keep every partial below Nyquist
+                float x = f > 0.f ? log2_fast(f * size * inv_sr) + 1.0f : 0.0f;
+                int lo = 0;
+                t[l] = 0.0f;
+                if (x > 0.0f) { lo = (int)x; t[l] = x - (float)lo; }
+                if (lo >= mt.levels - 1) { lo = mt.levels - 1; t[l] = 0.0f; }
+                la[l] = mt.level(lo);
+                lb[l] = mt.level(lo + 1 < mt.levels ? lo + 1 : lo);
+            }
+            vfloat vt = v_load(t);
+            for (int k = i; k < i + len; ++k) {
+                vfloat inc = vhz * pitch[k] * inv_sr;
+                vfloat idx = ph * size;
+                vint ii = v_to_int(idx);
+                vfloat fr = idx - v_to_float(ii);
+                v_store_int(i0, ii);
+                for (int l = 0; l < W; ++l) {
+                    a0[l] = la[l][i0[l]]; a1[l] = la[l][i0[l] + 1];
+                    b0[l] = lb[l][i0[l]]; b1[l] = lb[l][i0[l] + 1];
+                }
+                vfloat va0 = v_load(a0), vb0 = v_load(b0);
+                vfloat sa = va0 + (v_load(a1) - va0) * fr;
+                vfloat sb = vb0 + (v_load(b1) - vb0) * fr;
+                v_store(dst + k * W, sa + (sb - sa) * vt);
+                ph = ph + inc;
+                ph = v_sel(ph >= 1.0f, ph - v_floor(ph), ph);
+            }
+        }
+        v_store(phase + v0, v_sel(keep, ph, v_load(phase + v0)));
+    }
+
+    // User wavetable oscillator for one voice group: like wt_group, plus a
+    // morph between the two frames around the position. The frame pair is
+    // picked once per control period; the morph amount follows the position
+    // per sample, clamped to that pair.
+    void wt_user_group(Synth& s, const FrameTable& ft, float* phase, int v0, const float* hz, const float* pitch,
+                       const float* pos, float* dst, int n) {
+        vmask keep = v_load(s.live + v0) > 0.5f;
+        float inv_sr = 1.0f / (float)s.sr;
+        float size = (float)ft.size;
+        int32_t mask = ft.size - 1;
+        int built = ft.built.load(std::memory_order_acquire);
+        float span = (float)(ft.frames - 1);
+        vfloat ph = v_load(phase + v0), vhz = v_load(hz);
+        const float* la[W]; // frame f0, levels lo / lo + 1
+        const float* lb[W];
+        const float* lc[W]; // frame f1
+        const float* ld[W];
+        float t[W];
+        int32_t i0[W], i1[W];
+        float a0[W], a1[W], b0[W], b1[W], c0[W], c1[W], d0[W], d1[W];
+        for (int i = 0; i < n; i += s.control_frames) {
+            int len = n - i < s.control_frames ? n - i : s.control_frames;
+            int f0 = (int)(pos[i] * span);
+            if (f0 > ft.frames - 2) f0 = ft.frames > 1 ? ft.frames - 2 : 0;
+            int f1 = ft.frames > 1 ? f0 + 1 : f0;
+            for (int l = 0; l < W; ++l) {
+                float f = hz[l] * pitch[i];
+                float x = f > 0.f ? log2_fast(f * size * inv_sr) + 1.0f : 0.0f;
+                int lo = 0;
+                t[l] = 0.0f;
+                if (x > 0.0f) { lo = (int)x; t[l] = x - (float)lo; }
+                if (lo >= ft.levels - 1) { lo = ft.levels - 1; t[l] = 0.0f; }
+                int hi = lo + 1 < ft.levels ? lo + 1 : lo;
+                la[l] = ft.level(f0, lo, built);
+                lb[l] = ft.level(f0, hi, built);
+                lc[l] = ft.level(f1, lo, built);
+                ld[l] = ft.level(f1, hi, built);
+            }
+            vfloat vt = v_load(t);
+            vfloat zero = v_set1(0.0f), one = v_set1(1.0f);
+            for (int k = i; k < i + len; ++k) {
+                vfloat inc = vhz * pitch[k] * inv_sr;
+                vfloat idx = ph * size;
+                vint ii = v_to_int(idx);
+                vfloat fr = idx - v_to_float(ii);
+                v_store_int(i0, ii);
+                v_store_int(i1, (ii + 1) & mask);
+                for (int l = 0; l < W; ++l) {
+                    a0[l] = la[l][i0[l]]; a1[l] = la[l][i1[l]];
+                    b0[l] = lb[l][i0[l]]; b1[l] = lb[l][i1[l]];
+                    c0[l] = lc[l][i0[l]]; c1[l] = lc[l][i1[l]];
+                    d0[l] = ld[l][i0[l]]; d1[l] = ld[l][i1[l]];
+                }
+                vfloat va0 = v_load(a0), vb0 = v_load(b0), vc0 = v_load(c0), vd0 = v_load(d0);
+                vfloat sa = va0 + (v_load(a1) - va0) * fr;
+                vfloat sb = vb0 + (v_load(b1) - vb0) * fr;
+                vfloat sc = vc0 + (v_load(c1) - vc0) * fr;
+                vfloat sd = vd0 + (v_load(d1) - vd0) * fr;
+                vfloat x0 = sa + (sb - sa) * vt;
+                vfloat x1 = sc + (sd - sc) * vt;
+                vfloat m = v_clamp(v_set1(pos[k] * span - (float)f0), zero, one);
+                v_store(dst + k * W, x0 + (x1 - x0) * m);
+                ph = ph + inc;
+                ph = v_sel(ph >= 1.0f, ph - v_floor(ph), ph);
+            }
+        }
+        v_store(phase + v0, v_sel(keep, ph, v_load(phase + v0)));
+    }
+
+    // Unison stack of one oscillator for a voice group. Every copy is a
+    // wt_group/wt_user_group oscillator at its own detune ratio, run for the
+    // group's W voices as one vector, so a copy costs table reads and a phase
+    // step but no envelope, filter or voice bookkeeping. The mip levels are
+    // picked per control period for the highest copy, so none aliases. Copies
+    // sum into dst at 1/sqrt(count); side, if given, gets them weighted by
+    // their stereo positions.
+    template <bool USER>
+    void unison_group(Synth& s, const Synth::Unison& u, const MipTable* mt, const FrameTable* ft,
+                      float (*phase)[MAX_VOICES], int v0, const float* hz, const float* pitch, const float* pos,
+                      float* dst, float* side, int n) {
+        vmask keep = v_load(s.live + v0) > 0.5f;
+        float inv_sr = 1.0f / (float)s.sr;
+        int32_t table = USER ? ft->size : mt->size;
+        float size = (float)table;
+        int32_t mask = table - 1;
+        int levels = USER ? ft->levels : mt->levels;
+        int built = USER ? ft->built.load(std::memory_order_acquire) : 0;
+        float span = USER ? (float)(ft->frames - 1) : 0.0f;
+        float top = u.ratio[u.voices - 1];
+        vfloat vhz = v_load(hz), zero = v_set1(0.0f), one = v_set1(1.0f);
+        const float* la[W]; // (frame f0,) levels lo / lo + 1
+        const float* lb[W];
+        const float* lc[W]; // frame f1 of a user table
+        const float* ld[W];
+        float t[W];
+        int32_t i0[W], i1[W];
+        float a0[W], a1[W], b0[W], b1[W], c0[W], c1[W], d0[W], d1[W];
+        std::memset(dst, 0, sizeof(float) * n * W);
+        if (side) std::memset(side, 0, sizeof(float) * n * W);
+        for (int i = 0; i < n; i += s.control_frames) {
+            int len = n - i < s.control_frames ? n - i : s.control_frames;
+            int f0 = 0, f1 = 0;
+            if (USER) {
+                f0 = (int)(pos[i] * span);
+                if (f0 > ft->frames - 2) f0 = ft->frames > 1 ? ft->frames - 2 : 0;
+                f1 = ft->frames > 1 ? f0 + 1 : f0;
+            }
+            for (int l = 0; l < W; ++l) {
+                float f = hz[l] * pitch[i] * top;
+                float x = f > 0.f ? log2_fast(f * size * inv_sr) + 1.0f : 0.0f;
+                int lo = 0;
+                t[l] = 0.0f;
+                if (x > 0.0f) { lo = (int)x; t[l] = x - (float)lo; }
+                if (lo >= levels - 1) { lo = levels - 1; t[l] = 0.0f; }
+                int hi = lo + 1 < levels ? lo + 1 : lo;
+                if (USER) {
+                    la[l] = ft->level(f0, lo, built);
+                    lb[l] = ft->level(f0, hi, built);
+                    lc[l] = ft->level(f1, lo, built);
+                    ld[l] = ft->level(f1, hi, built);
+                } else {
+                    la[l] = mt->level(lo);
+                    lb[l] = mt->level(hi);
+                }
+            }
+            vfloat vt = v_load(t);
+            for (int c = 0; c < u.voices; ++c) {
+                vfloat ph = v_load(phase[c] + v0);
+                vfloat pc = v_set1(u.pan[c]);
+                float ratio = u.ratio[c] * inv_sr;
+                for (int k = i; k < i + len; ++k) {
+                    vfloat inc = vhz * (pitch[k] * ratio);
+                    vfloat idx = ph * size;
+                    vint ii = v_to_int(idx);
+                    vfloat fr = idx - v_to_float(ii);
+                    v_store_int(i0, ii);
+                    v_store_int(i1, (ii + 1) & mask);
+                    for (int l = 0; l < W; ++l) {
+                        a0[l] = la[l][i0[l]]; a1[l] = la[l][i1[l]];
+                        b0[l] = lb[l][i0[l]]; b1[l] = lb[l][i1[l]];
+                    }
+                    vfloat va0 = v_load(a0), vb0 = v_load(b0);
+                    vfloat sa = va0 + (v_load(a1) - va0) * fr;
+                    vfloat sb = vb0 + (v_load(b1) - vb0) * fr;
+                    vfloat x = sa + (sb - sa) * vt;
+                    if (USER) {
+                        for (int l = 0; l < W; ++l) {
+                            c0[l] = lc[l][i0[l]]; c1[l] = lc[l][i1[l]];
+                            d0[l] = ld[l][i0[l]]; d1[l] = ld[l][i1[l]];
+                        }
+                        vfloat vc0 = v_load(c0), vd0 = v_load(d0);
+                        vfloat sc = vc0 + (v_load(c1) - vc0) * fr;
+                        vfloat sd = vd0 + (v_load(d1) - vd0) * fr;
+                        vfloat x1 = sc + (sd - sc) * vt;
+                        vfloat m = v_clamp(v_set1(pos[k] * span - (float)f0), zero, one);
+                        x = x + (x1 - x) * m;
+                    }
+                    v_store(dst + k * W, v_load(dst + k * W) + x);
+                    if (side) v_store(side + k * W, v_load(side + k * W) + x * pc);
+                    ph = ph + inc;
+                    ph = v_sel(ph >= 1.0f, ph - v_floor(ph), ph);
+                }
+                v_store(phase[c] + v0, v_sel(keep, ph, v_load(phase[c] + v0)));
+            }
+        }
+        for (int k = 0; k < n; ++k) {
+            v_store(dst + k * W, v_load(dst + k * W) * u.gain);
+            if (side) v_store(side + k * W, v_load(side + k * W) * u.gain);
+        }
+    }
+
+    inline bool uses_fm(const OscShape& o) { return o.wave == WAVE_FM || o.from == WAVE_FM; }
+
+    // One oscillator of the group rendering the given shape. Wavetable shapes
+    // run as a unison stack when the oscillator has one; FM stays single.
+    void shape_group(Synth& s, int wave, int osc, float* phase, float (*uphase)[MAX_VOICES], int v0,
+                     const float* hz, float* dst, float* side, int n) {
+        const float* pitch = osc == 1 ? s.pitch1_buf : s.pitch2_buf;
+        const float* pos = osc == 1 ? s.pos1_buf : s.pos2_buf;
+        const Synth::Unison& u = s.unison[osc - 1];
+        bool stack = u.voices > 1 && wave != WAVE_FM;
+        if (side && !stack) std::memset(side, 0, sizeof(float) * n * W);
+        if (wave == WAVE_FM) {
+            fm_kernel(s.fm[osc - 1], s.fm_patch[osc - 1], v0, s.live, hz, pitch,
+                      osc == 1 ? s.fm1_idx_buf : s.fm2_idx_buf, (float)s.sr, dst, n);
+        } else if (const FrameTable* ft = user_table(s, wave)) {
+            if (stack) unison_group<true>(s, u, nullptr, ft, uphase, v0, hz, pitch, pos, dst, side, n);
+            else wt_user_group(s, *ft, phase, v0, hz, pitch, pos, dst, n);
+        } else {
+            const MipTable& mt = *s.tables[(wave >= 0 && wave < WAVE_SHAPE_COUNT) ? wave : WAVE_SINE];
+            if (stack) unison_group<false>(s, u, &mt, nullptr, uphase, v0, hz, pitch, pos, dst, side, n);
+            else wt_group(s, mt, phase, v0, hz, pitch, dst, n);
+        }
+    }
+
+    // Oscillator stage. During a shape switch the old shape runs on a copy of
+    // the phases (the new one keeps the real phases, so nothing resets) and
+    // the two are crossfaded.
+    void osc_group(Synth& s, GroupScratch& g, const OscShape& o, int osc, float* phase, const float* fade, int v0,
+                   const float* hz, float* dst, float* side, int n) {
+        float (*uphase)[MAX_VOICES] = s.uphase[osc - 1];
+        if (o.fading) {
+            std::memcpy(s.phase_fade + v0, phase + v0, sizeof(float) * W);
+            for (int c = 0; c < s.unison[osc - 1].voices; ++c) {
+                std::memcpy(s.uphase_fade[c] + v0, uphase[c] + v0, sizeof(float) * W);
+            }
+            shape_group(s, o.from, osc, s.phase_fade, s.uphase_fade, v0, hz, g.voice_buf,
+                        side ? g.side_buf : nullptr, n);
+        }
+        shape_group(s, o.wave, osc, phase, uphase, v0, hz, dst, side, n);
+        if (!o.fading) return;
+        for (int i = 0; i < n; ++i) {
+            vfloat prev = v_load(g.voice_buf + i * W);
+            v_store(dst + i * W, prev + (v_load(dst + i * W) - prev) * fade[i]);
+        }
+        if (!side) return;
+        for (int i = 0; i < n; ++i) {
+            vfloat prev = v_load(g.side_buf + i * W);
+            v_store(side + i * W, prev + (v_load(side + i * W) - prev) * fade[i]);
+        }
+    }
+
+    // Oscillator mix stage: dst = s1 * g1 + s2 * g2 (and the same for the sides)
+    void mix_group(Synth& s, GroupScratch& g, int n) {
+        bool lanes = s.voice_route_count && (s.voice_dests & (1u << SYNTH_MOD_GAIN1 | 1u << SYNTH_MOD_GAIN2));
+        if (lanes) { // per-voice gain routes
+            vfloat zero = v_set1(0.0f), two = v_set1(2.0f);
+            vfloat m1 = s.voice_dests >> SYNTH_MOD_GAIN1 & 1u ? v_load(g.voice_mod[SYNTH_MOD_GAIN1]) : zero;
+            vfloat m2 = s.voice_dests >> SYNTH_MOD_GAIN2 & 1u ? v_load(g.voice_mod[SYNTH_MOD_GAIN2]) : zero;
+            for (int i = 0; i < n; ++i) {
+                vfloat g1 = v_clamp(m1 + s.gain1_buf[i], zero, two), g2 = v_clamp(m2 + s.gain2_buf[i], zero, two);
+                v_store(g.voice_buf + i * W, v_load(g.osc1_buf + i * W) * g1 + v_load(g.osc2_buf + i * W) * g2);
+                if (s.wide) v_store(g.side_buf + i * W, v_load(g.osc1_side + i * W) * g1 + v_load(g.osc2_side + i * W) * g2);
+            }
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            v_store(g.voice_buf + i * W,
+                    v_load(g.osc1_buf + i * W) * s.gain1_buf[i] + v_load(g.osc2_buf + i * W) * s.gain2_buf[i]);
+        }
+        if (!s.wide) return;
+        for (int i = 0; i < n; ++i) {
+            v_store(g.side_buf + i * W,
+                    v_load(g.osc1_side + i * W) * s.gain1_buf[i] + v_load(g.osc2_side + i * W) * s.gain2_buf[i]);
+        }
+    }
+
+    // The selected filter kernel over io, on the given state
+    void run_filter(Synth& s, LadderState& vcf, ZdfState& zdf, GroupScratch& g, float* io, int v0, int n) {
+        // The governor's filter level drops oversampling
+        bool economy = s.quality >= QUALITY_FILTER;
+        float sr = (float)s.sr;
+        switch (s.filter_mode) {
+            case FILTER_ZDF:
+            case FILTER_ZDF_2X:
+                zdf_ladder_kernel(zdf, v0, s.live, io, g.cut_buf, s.res_buf, sr, n, s.control_frames,
+                                  s.filter_mode == FILTER_ZDF_2X && !economy);
+                break;
+            case FILTER_SVF:
+                svf_kernel(zdf, v0, s.live, io, g.cut_buf, s.res_buf, sr, n, s.control_frames);
+                break;
+            default:
+                if (economy) ladder_kernel_fast(vcf, v0, s.live, io, g.cut_buf, s.res_buf, sr, n);
+                else ladder_kernel(vcf, v0, s.live, io, g.cut_buf, s.res_buf, sr, n);
+                break;
+        }
+    }
+
+    // Filter stage: cutoff from base cutoff + filter env, then the filter
+    // kernel; a wide unison side signal runs through its own copy of it
+    void filter_group(Synth& s, GroupScratch& g, int v0, int n) {
+        vfloat lo = v_set1(20.0f), hi = v_set1(0.5f * (float)s.sr - 100.0f);
+        if (s.voice_route_count && (s.voice_dests >> SYNTH_MOD_CUTOFF & 1u)) { // per-voice cutoff routes
+            vfloat m = v_load(g.voice_mod[SYNTH_MOD_CUTOFF]);
+            for (int i = 0; i < n; ++i) {
+                vfloat c = v_load(g.fenv_buf + i * W) * s.fenv_amt_buf[i] + s.cutoff_buf[i];
+                v_store(g.cut_buf + i * W, v_clamp(c + m, lo, hi));
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                vfloat c = v_load(g.fenv_buf + i * W) * s.fenv_amt_buf[i] + s.cutoff_buf[i];
+                v_store(g.cut_buf + i * W, v_clamp(c, lo, hi));
+            }
+        }
+        run_filter(s, s.vcf, s.zdf, g, g.voice_buf, v0, n);
+        if (s.wide) run_filter(s, s.vcf_side, s.zdf_side, g, g.side_buf, v0, n);
+    }
+
+    // Per-voice routes for the group's lanes, with the sources sampled at the
+    // start of the block (envelopes at their last output)
+    void voice_mod(Synth& s, GroupScratch& g, int v0) {
+        for (int d = 0; d < SYNTH_MOD_DESTS; ++d) {
+            if (s.voice_dests >> d & 1u) std::memset(g.voice_mod[d], 0, sizeof(g.voice_mod[d]));
+        }
+        for (int k = 0; k < s.voice_route_count; ++k) {
+            const Synth::ModRoute& r = s.voice_routes[k];
+            float* dst = g.voice_mod[r.dest];
+            for (int l = 0; l < W; ++l) {
+                int v = v0 + l;
+                float x;
+                switch (r.source) {
+                    case SYNTH_MOD_AMP_ENV: x = s.env.y[v]; break;
+                    case SYNTH_MOD_FILTER_ENV: x = s.fenv.y[v]; break;
+                    case SYNTH_MOD_VELOCITY: x = s.voices[v].vel; break;
+                    default: x = log2_fast(s.voices[v].base_hz * (1.0f / 261.62558f)); break; // SYNTH_MOD_KEY
+                }
+                dst[l] += r.amount * x;
+            }
+        }
+    }
+
+    // Velocity times master amplitude for sample i, plus a per-voice amp route
+    inline vfloat vca_gain(const Synth& s, vfloat vel, const float* amp_mod, int i) {
+        if (!amp_mod) return vel * s.amp_buf[i];
+        return vel * v_clamp(v_set1(s.amp_buf[i]) + v_load(amp_mod), v_set1(0.0f), v_set1(2.0f));
+    }
+
+    // Render voices v0..v0+W-1 over n samples into their group_out slot. Touches
+    // only the group's own lanes and voices, so groups can run on any thread.
+    void group_block(Synth& s, GroupScratch& g, int v0, int n) {
+        float hz[W], vel[W];
+        float sr = (float)s.sr;
+        for (int l = 0; l < W; ++l) {
+            Voice& vc = s.voices[v0 + l];
+            hz[l] = vc.base_hz;
+            vel[l] = vc.vel;
+            if (s.live[v0 + l] != 0.0f) {
+                float gate = vc.gate > 0.f ? 1.0f : 0.0f;
+                env_gate(s.fenv, v0 + l, gate, s.fenv_params, sr);
+                env_gate(s.env, v0 + l, gate, s.env_params, sr);
+                if (uses_fm(s.osc1)) fm_gate(s.fm[0], s.fm_patch[0], v0 + l, gate, sr);
+                if (uses_fm(s.osc2)) fm_gate(s.fm[1], s.fm_patch[1], v0 + l, gate, sr);
+            }
+        }
+
+        const float* amp_mod = nullptr;
+        if (s.voice_route_count) {
+            voice_mod(s, g, v0);
+            if (s.voice_dests >> SYNTH_MOD_PITCH & 1u) {
+                for (int l = 0; l < W; ++l) hz[l] *= exp2_fast(g.voice_mod[SYNTH_MOD_PITCH][l] * (1.0f / 12.0f));
+            }
+            if (s.voice_dests >> SYNTH_MOD_AMP & 1u) amp_mod = g.voice_mod[SYNTH_MOD_AMP];
+        }
+
+        // Oscillators
+        osc_group(s, g, s.osc1, 1, s.phase1, s.fade1_buf, v0, hz, g.osc1_buf, s.wide ? g.osc1_side : nullptr, n);
+        osc_group(s, g, s.osc2, 2, s.phase2, s.fade2_buf, v0, hz, g.osc2_buf, s.wide ? g.osc2_side : nullptr, n);
+        mix_group(s, g, n);
+
+        // Filter envelope + ladder
+        if (s.filter_on) {
+            env_kernel(s.fenv, v0, s.fenv_params, sr, s.live, g.fenv_buf, n);
+            filter_group(s, g, v0, n);
+        }
+
+        // Amplitude envelope / VCA
+        env_kernel(s.env, v0, s.env_params, sr, s.live, g.env_buf, n);
+        vfloat vvel = v_load(vel);
+        float* out = s.group_out[v0 / W];
+        float* side = s.wide ? s.group_side[v0 / W] : nullptr;
+        vfloat kill_step = v_load(s.steal_step + v0);
+        if (v_any(kill_step < 0.0f)) { // a voice is fading out to be stolen
+            vfloat kill = v_load(s.steal_gain + v0), zero = v_set1(0.0f);
+            for (int i = 0; i < n; ++i) {
+                kill = v_max(kill + kill_step, zero);
+                vfloat level = vca_gain(s, vvel, amp_mod, i);
+                v_store(out + i * W, v_load(g.voice_buf + i * W) * v_load(g.env_buf + i * W) * level * kill);
+                if (side) v_store(side + i * W, v_load(g.side_buf + i * W) * v_load(g.env_buf + i * W) * level * kill);
+            }
+            v_store(s.steal_gain + v0, kill);
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            v_store(out + i * W, v_load(g.voice_buf + i * W) * v_load(g.env_buf + i * W) * vca_gain(s, vvel, amp_mod, i));
+        }
+        if (!side) return;
+        for (int i = 0; i < n; ++i) {
+            v_store(side + i * W, v_load(g.side_buf + i * W) * v_load(g.env_buf + i * W) * vca_gain(s, vvel, amp_mod, i));
+        }
+    }
+
+    // One block of group rendering shared by the pool: each worker claims the
+    // next live group until none are left
+    struct GroupJob {
+        Synth* s;
+        int n;
+        std::atomic<int> next{0};
+    };
+
+    void group_job(void* ctx, int worker) {
+        GroupJob& job = *static_cast<GroupJob*>(ctx);
+        Synth& s = *job.s;
+        GroupScratch& g = s.scratch[worker];
+        for (int k; (k = job.next.fetch_add(1, std::memory_order_relaxed)) < s.group_count;) {
+            group_block(s, g, s.group_list[k] * W, job.n);
+        }
+    }
+
+    // Threads worth using for this many voices (1 = render on the caller)
+    int render_threads(const Synth& s, int live_voices, int live_groups) {
+        if (s.threads <= 1) return 1;
+        int t = live_voices / s.min_voices_per_thread;
+        if (t > s.threads) t = s.threads;
+        if (t > live_groups) t = live_groups;
+        return t < 1 ? 1 : t;
+    }
+
+    // Destination of a render call: planar channels (one = mono, unpanned) and
+    // an output gain, per frame or as a linear ramp over the call
+    struct RenderOut {
+        float* const* ch;
+        int channels;
+        const float* gain = nullptr; // one value per frame, or nullptr to use the ramp
+        float gain0 = 1.0f;          // ramp value at frame 0
+        float gain_step = 0.0f;      // ramp change per frame
+        bool add = false;            // add into the channels instead of overwriting
+    };
+
+    // Copy the block mix to frames at..at+n-1 of every channel, applying the
+    // gain. Channels beyond the first two repeat the left/right pair.
+    void write_block(const Synth& s, const RenderOut& o, bool stereo, int at, int n) {
+        bool ramp = o.gain_step != 0.0f || o.gain0 != 1.0f;
+        for (int c = 0; c < o.channels; ++c) {
+            const float* src = s.mix_buf[stereo ? (c & 1) : 0];
+            float* dst = o.ch[c] + at;
+            if (o.gain) {
+                const float* g = o.gain + at;
+                if (o.add) for (int i = 0; i < n; ++i) dst[i] += src[i] * g[i];
+                else for (int i = 0; i < n; ++i) dst[i] = src[i] * g[i];
+            } else if (ramp) {
+                float g0 = o.gain0 + o.gain_step * (float)at;
+                if (o.add) for (int i = 0; i < n; ++i) dst[i] += src[i] * (g0 + o.gain_step * (float)i);
+                else for (int i = 0; i < n; ++i) dst[i] = src[i] * (g0 + o.gain_step * (float)i);
+            } else if (o.add) {
+                for (int i = 0; i < n; ++i) dst[i] += src[i];
+            } else {
+                std::memcpy(dst, src, sizeof(float) * n);
+            }
+        }
+    }
+
+    // Add one voice's block to the stereo mix, gliding its channel gains to
+    // the current pan over the block. A side signal (wide unison) moves the
+    // voice's left and right apart around its pan.
+    void pan_voice(Synth& s, Voice& vc, const float* buf, const float* side, int l, int n) {
+        float g0 = vc.pan_gain[0], g1 = vc.pan_gain[1];
+        float p = voice_pan(s, vc);
+        if (p != vc.pan) {
+            vc.pan = p;
+            pan_gains(p, vc.pan_gain);
+        }
+        float* left = s.mix_buf[0];
+        float* right = s.mix_buf[1];
+        if (side) {
+            float d0 = (vc.pan_gain[0] - g0) / (float)n, d1 = (vc.pan_gain[1] - g1) / (float)n;
+            for (int i = 0; i < n; ++i) {
+                float x = buf[i * W + l], y = side[i * W + l], k = (float)(i + 1);
+                left[i] += (x - y) * (g0 + d0 * k);
+                right[i] += (x + y) * (g1 + d1 * k);
+            }
+            return;
+        }
+        if (g0 == vc.pan_gain[0] && g1 == vc.pan_gain[1]) {
+            for (int i = 0; i < n; ++i) {
+                float x = buf[i * W + l];
+                left[i] += x * g0;
+                right[i] += x * g1;
+            }
+            return;
+        }
+        float d0 = (vc.pan_gain[0] - g0) / (float)n, d1 = (vc.pan_gain[1] - g1) / (float)n;
+        for (int i = 0; i < n; ++i) {
+            float x = buf[i * W + l], k = (float)(i + 1);
+            left[i] += x * (g0 + d0 * k);
+            right[i] += x * (g1 + d1 * k);
+        }
+    }
+
+    // Level, NaN and denormal check of the block mix. A NaN/Inf mix is muted,
+    // so one blown-up voice cannot reach the output.
+    void scan_block(Synth& s, bool stereo, int n) {
+        float peak = s.call_peak, sumsq = 0.0f;
+        bool bad = false, denormal = false;
+        for (int c = 0; c < (stereo ? 2 : 1); ++c) {
+            const float* mix = s.mix_buf[c];
+            for (int i = 0; i < n; ++i) {
+                float a = std::fabs(mix[i]);
+                bad |= !(a <= FLT_MAX);
+                denormal |= a < FLT_MIN && a != 0.0f;
+                peak = a > peak ? a : peak;
+                sumsq += a * a;
+            }
+        }
+        if (bad) {
+            std::memset(s.mix_buf, 0, sizeof(s.mix_buf));
+            s.stats.nan_blocks.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (denormal) s.stats.denormal_blocks.fetch_add(1, std::memory_order_relaxed);
+        s.call_peak = peak;
+        s.call_sumsq += stereo ? 0.5f * sumsq : sumsq;
+    }
+
+    // Render n frames in BLOCK_FRAMES chunks with the current parameters into
+    // frames at..at+frames-1 of the output
+    void render_segment(Synth& s, const RenderOut& o, int at, int frames) {
+        bool stereo = o.channels > 1;
+        for (int off = 0; off < frames; off += BLOCK_FRAMES) {
+            int n = frames - off < BLOCK_FRAMES ? frames - off : BLOCK_FRAMES;
+            float* mix = s.mix_buf[0];
+            std::memset(s.mix_buf, 0, sizeof(s.mix_buf));
+            control_block(s, n);
+            // Side signals for stereo output of a wide unison stack; their
+            // filters start from silence whenever they come back into use
+            bool wide = stereo && ((s.unison[0].voices > 1 && s.unison[0].width > 0.0f) ||
+                                   (s.unison[1].voices > 1 && s.unison[1].width > 0.0f));
+            if (wide && !s.wide) {
+                ladder_reset(s.vcf_side);
+                zdf_reset(s.zdf_side);
+            }
+            s.wide = wide;
+            // Groups holding a voice in use; idle slots are never touched
+            int live_voices = 0;
+            s.group_count = 0;
+            for (int v = next_used_voice(s, 0); v < MAX_VOICES;) {
+                int v0 = v - v % W;
+                for (int l = 0; l < W; ++l) {
+                    bool live = voice_in_use(s, v0 + l);
+                    s.live[v0 + l] = live ? 1.0f : 0.0f;
+                    live_voices += live ? 1 : 0;
+                }
+                s.group_list[s.group_count++] = v0 / W;
+                v = next_used_voice(s, v0 + W);
+            }
+            int threads = render_threads(s, live_voices, s.group_count);
+            if (threads <= 1) {
+                for (int k = 0; k < s.group_count; ++k) group_block(s, s.scratch[0], s.group_list[k] * W, n);
+            } else {
+                GroupJob job{&s, n};
+                WorkerPool::instance().run(threads, group_job, &job);
+            }
+            // Accumulate lane by lane in voice order, so the sum matches a scalar
+            // build and any thread count
+            for (int k = 0; k < s.group_count; ++k) {
+                int v0 = s.group_list[k] * W;
+                const float* buf = s.group_out[s.group_list[k]];
+                const float* side = s.wide ? s.group_side[s.group_list[k]] : nullptr;
+                for (int l = 0; l < W; ++l) {
+                    int v = v0 + l;
+                    if (s.live[v] == 0.0f) continue;
+                    Voice& vc = s.voices[v];
+                    if (stereo) pan_voice(s, vc, buf, side, l, n);
+                    else for (int i = 0; i < n; ++i) mix[i] += buf[i * W + l];
+                    // Under load, releasing voices that are barely audible fade out now
+                    if (s.quality >= QUALITY_CULL && vc.gate <= 0.f && s.steal_step[v] == 0.0f &&
+                        vc.pending_midi < 0 && s.env.y[v] * vc.vel < s.gov_cull) {
+                        fade_out_voice(s, v);
+                    }
+                    // Released and silent (env.y holds the envelope's last
+                    // sample): free the slot, or start the note that stole it
+                    if (vc.gate > 0.f || (s.env.y[v] >= 1e-4f && s.steal_gain[v] > 0.0f)) continue;
+                    if (vc.pending_midi < 0) {
+                        free_voice(s, v);
+                        continue;
+                    }
+                    env_reset_voice(s.env, v);
+                    env_reset_voice(s.fenv, v);
+                    ladder_reset_voice(s.vcf, v);
+                    zdf_reset_voice(s.zdf, v);
+                    ladder_reset_voice(s.vcf_side, v);
+                    zdf_reset_voice(s.zdf_side, v);
+                    s.steal_gain[v] = 1.0f;
+                    s.steal_step[v] = 0.0f;
+                    start_voice(s, v, vc.pending_midi, vc.pending_vel);
+                }
+            }
+            scan_block(s, stereo, n);
+            write_block(s, o, stereo, at + off, n);
+        }
+    }
+
+    // Dispatch a queued event to the matching setter
+    void apply_event(Synth& s, const SynthEvent& ev) {
+        switch (ev.type) {
+            case SYNTH_EV_NOTE_ON: synth_note_on(&s, ev.i, ev.a); break;
+            case SYNTH_EV_NOTE_OFF:
+                if (ev.i >= 0) synth_note_off_midi(&s, ev.i);
+                else synth_note_off(&s);
+                break;
+            case SYNTH_EV_AMP: synth_set_amp(&s, ev.a); break;
+            case SYNTH_EV_WAVE: synth_set_wave(&s, ev.i); break;
+            case SYNTH_EV_WAVE1: synth_set_wave1(&s, ev.i); break;
+            case SYNTH_EV_WAVE2: synth_set_wave2(&s, ev.i); break;
+            case SYNTH_EV_DETUNE1: synth_set_detune1(&s, ev.a); break;
+            case SYNTH_EV_DETUNE2: synth_set_detune2(&s, ev.a); break;
+            case SYNTH_EV_GAIN1: synth_set_gain1(&s, ev.a); break;
+            case SYNTH_EV_GAIN2: synth_set_gain2(&s, ev.a); break;
+            case SYNTH_EV_FM1: synth_fm1(&s, ev.a, ev.b, ev.c); break;
+            case SYNTH_EV_FM2: synth_fm2(&s, ev.a, ev.b, ev.c); break;
+            case SYNTH_EV_ENV: synth_set_env(&s, ev.a, ev.b, ev.c, ev.d); break;
+            case SYNTH_EV_POLY: synth_set_poly(&s, ev.i); break;
+            case SYNTH_EV_FILTER: synth_filter_set(&s, ev.a, ev.b); break;
+            case SYNTH_EV_FILTER_ENV: synth_filter_env(&s, ev.a, ev.b, ev.c, ev.d); break;
+            case SYNTH_EV_FILTER_ENV_AMOUNT: synth_filter_env_amount(&s, ev.a); break;
+            case SYNTH_EV_FILTER_ENABLE: synth_filter_enable(&s, ev.i); break;
+            case SYNTH_EV_LFO_RATE: synth_lfo_set(&s, ev.a); break;
+            case SYNTH_EV_LFO_DEST: synth_lfo_dest(&s, ev.i); break;
+            case SYNTH_EV_LFO_AMOUNT: synth_lfo_amount(&s, ev.a); break;
+            case SYNTH_EV_SMOOTHING: synth_set_smoothing(&s, ev.a); break;
+            case SYNTH_EV_WAVE_CROSSFADE: synth_set_wave_crossfade(&s, ev.a); break;
+            case SYNTH_EV_POSITION1: synth_set_position1(&s, ev.a); break;
+            case SYNTH_EV_POSITION2: synth_set_position2(&s, ev.a); break;
+            case SYNTH_EV_PAN: synth_set_pan(&s, ev.a); break;
+            case SYNTH_EV_SPREAD: synth_set_spread(&s, ev.a); break;
+            case SYNTH_EV_FILTER_MODE: synth_filter_mode(&s, ev.i); break;
+            case SYNTH_EV_FM_ALGORITHM: synth_fm_algorithm(&s, ev.i, (int)ev.a); break;
+            case SYNTH_EV_FM_FEEDBACK: synth_fm_feedback(&s, ev.i, ev.a); break;
+            case SYNTH_EV_FM_OP: synth_fm_op(&s, ev.i / FM_OPS + 1, ev.i % FM_OPS + 1, ev.a, ev.b); break;
+            case SYNTH_EV_FM_OP_ENV: synth_fm_op_env(&s, ev.i / FM_OPS + 1, ev.i % FM_OPS + 1, ev.a, ev.b, ev.c, ev.d); break;
+            case SYNTH_EV_UNISON: synth_unison(&s, ev.i, (int)ev.a, ev.b, ev.c, ev.d); break;
+            case SYNTH_EV_UNISON_PHASE: synth_unison_phase(&s, ev.i, ev.a); break;
+            case SYNTH_EV_MOD_ROUTE: synth_mod_route(&s, ev.i, (int)ev.a, (int)ev.b, ev.c); break;
+            case SYNTH_EV_MOD_LFO: synth_mod_lfo(&s, ev.i, ev.a, (int)ev.b); break;
+            case SYNTH_EV_MOD_WHEEL: synth_mod_wheel(&s, ev.a); break;
+            default: break;
+        }
+    }
+
+    SynthPatch capture_patch(const Synth& s) {
+        SynthPatch p;
+        p.amp = s.master_amp.target;
+        p.smooth_ms = s.smooth_ms;
+        p.env = s.env_params;
+        p.poly = s.poly_n;
+        p.cutoff = s.fcut.target;
+        p.resonance = s.fres.target;
+        p.filter_on = s.filter_on ? 1 : 0;
+        p.filter_mode = s.filter_mode;
+        p.fenv = s.fenv_params;
+        p.fenv_amt = s.fenv_amt.target;
+        p.lfo_rate = s.lfo[0].rate;
+        p.lfo_amt_semi = s.lfo_amt_semi;
+        p.lfo_dest = s.lfo_dest;
+        p.lfo_amt = s.lfo_amt;
+        p.wave_fade_ms = s.wave_fade_ms;
+        p.wave[0] = s.osc1.wave;
+        p.wave[1] = s.osc2.wave;
+        p.detune[0] = s.detune1;
+        p.detune[1] = s.detune2;
+        p.det_ratio[0] = s.det1_ratio.target;
+        p.det_ratio[1] = s.det2_ratio.target;
+        p.gain[0] = s.gain1.target;
+        p.gain[1] = s.gain2.target;
+        p.position[0] = s.pos1.target;
+        p.position[1] = s.pos2.target;
+        p.fm_index[0] = s.fm1_indx.target;
+        p.fm_index[1] = s.fm2_indx.target;
+        p.fm[0] = s.fm_patch[0];
+        p.fm[1] = s.fm_patch[1];
+        p.pan = s.pan;
+        p.spread = s.spread;
+        for (int o = 0; o < 2; ++o) {
+            const Synth::Unison& u = s.unison[o];
+            p.unison_voices[o] = u.voices;
+            p.unison_detune[o] = u.detune;
+            p.unison_curve[o] = u.curve;
+            p.unison_width[o] = u.width;
+            p.unison_random[o] = u.random;
+        }
+        for (int l = 0; l < MOD_LFOS; ++l) p.lfo_shape[l] = s.lfo[l].shape;
+        p.lfo_rate23[0] = s.lfo[1].rate;
+        p.lfo_rate23[1] = s.lfo[2].rate;
+        for (int k = 0; k < SYNTH_MOD_ROUTES; ++k) {
+            p.routes[k].source = s.routes[k].source;
+            p.routes[k].dest = s.routes[k].dest;
+            p.routes[k].amount = s.routes[k].amount;
+        }
+        return p;
+    }
+
+    // Apply a whole patch between two blocks. Continuous parameters glide
+    // together over the patch's smoothing time and shapes crossfade, so held
+    // notes move to the new sound without passing through partial states.
+    void apply_patch(Synth& s, const SynthPatch& p) {
+        synth_set_smoothing(&s, p.smooth_ms);
+        int ramp = ramp_samples(s);
+        s.master_amp.set(p.amp, ramp);
+        s.env_params = p.env;
+        if (p.poly != s.poly_n) synth_set_poly(&s, p.poly);
+        s.fcut.set(p.cutoff, ramp);
+        s.fres.set(p.resonance, ramp);
+        synth_filter_enable(&s, p.filter_on);
+        synth_filter_mode(&s, p.filter_mode);
+        s.fenv_params = p.fenv;
+        s.fenv_amt.set(p.fenv_amt, ramp);
+        s.lfo_amt_semi = p.lfo_amt_semi;
+        s.lfo_amt = p.lfo_amt;
+        // A new destination fades its depth in rather than jumping to it
+        if (p.lfo_dest != s.lfo_dest) s.lfo_depth.reset(0.0f);
+        s.lfo_dest = p.lfo_dest;
+        s.lfo_depth.set(lfo_depth_target(s), ramp);
+        synth_set_wave_crossfade(&s, p.wave_fade_ms);
+        switch_shape(s, s.osc1, p.wave[0]);
+        switch_shape(s, s.osc2, p.wave[1]);
+        s.detune1 = p.detune[0];
+        s.detune2 = p.detune[1];
+        s.det1_ratio.set(p.det_ratio[0], ramp);
+        s.det2_ratio.set(p.det_ratio[1], ramp);
+        s.gain1.set(p.gain[0], ramp);
+        s.gain2.set(p.gain[1], ramp);
+        s.pos1.set(clampf(p.position[0], 0.f, 1.f), ramp);
+        s.pos2.set(clampf(p.position[1], 0.f, 1.f), ramp);
+        s.fm1_indx.set(p.fm_index[0], ramp);
+        s.fm2_indx.set(p.fm_index[1], ramp);
+        for (int o = 1; o <= 2; ++o) {
+            const FmPatch& fm = p.fm[o - 1];
+            synth_fm_algorithm(&s, o, fm.algorithm);
+            synth_fm_feedback(&s, o, fm.feedback);
+            for (int op = 1; op <= FM_OPS; ++op) {
+                const FmOp& x = fm.op[op - 1];
+                synth_fm_op(&s, o, op, x.ratio, x.level);
+                if (x.env_on) synth_fm_op_env(&s, o, op, x.env.atk < 0.f ? 0.f : x.env.atk, x.env.dec, x.env.sus, x.env.rel);
+                else synth_fm_op_env(&s, o, op, -1.f, 0.f, 0.f, 0.f);
+            }
+        }
+        synth_set_pan(&s, p.pan);
+        synth_set_spread(&s, p.spread);
+        for (int o = 1; o <= 2; ++o) {
+            const Synth::Unison& u = s.unison[o - 1];
+            if (u.voices != p.unison_voices[o - 1] || u.detune != p.unison_detune[o - 1] ||
+                u.curve != p.unison_curve[o - 1] || u.width != p.unison_width[o - 1]) {
+                synth_unison(&s, o, p.unison_voices[o - 1], p.unison_detune[o - 1], p.unison_curve[o - 1],
+                             p.unison_width[o - 1]);
+            }
+            synth_unison_phase(&s, o, p.unison_random[o - 1]);
+        }
+        synth_mod_lfo(&s, 1, p.lfo_rate, p.lfo_shape[0]);
+        synth_mod_lfo(&s, 2, p.lfo_rate23[0], p.lfo_shape[1]);
+        synth_mod_lfo(&s, 3, p.lfo_rate23[1], p.lfo_shape[2]);
+        for (int k = 0; k < SYNTH_MOD_ROUTES; ++k) {
+            const PatchRoute& r = p.routes[k];
+            synth_mod_route(&s, k, r.source, r.dest, r.amount);
+        }
+    }
+
+    void set_quality(Synth& s, int level) {
+        s.quality = level < 0 ? 0 : (level >= QUALITY_LEVELS ? QUALITY_LEVELS - 1 : level);
+        s.control_frames = s.quality >= QUALITY_CONTROL ? BLOCK_FRAMES : CONTROL_FRAMES;
+        s.stats.quality.store((uint32_t)s.quality, std::memory_order_relaxed);
+    }
+
+    // CPU governor: drop one quality level while the smoothed load stays above
+    // gov_degrade (at most every GOV_STEP_HOLD_S), and climb back one level
+    // after the load has stayed below gov_recover for GOV_RECOVER_S
+    void govern(Synth& s, float load, int frames) {
+        if (!s.gov_on) return;
+        float dt = (float)frames / (float)s.sr;
+        float k = dt / GOV_LOAD_SMOOTH_S;
+        s.gov_load += (load - s.gov_load) * (k > 1.0f ? 1.0f : k);
+        s.gov_hold -= dt;
+        if (s.gov_load > s.gov_degrade) {
+            s.gov_calm = 0.0f;
+            if (s.gov_hold <= 0.0f && s.quality < QUALITY_LEVELS - 1) {
+                set_quality(s, s.quality + 1);
+                s.gov_hold = GOV_STEP_HOLD_S;
+            }
+        } else if (s.gov_load < s.gov_recover && s.quality > QUALITY_FULL) {
+            s.gov_calm += dt;
+            if (s.gov_calm >= GOV_RECOVER_S) {
+                set_quality(s, s.quality - 1);
+                s.gov_calm = 0.0f;
+            }
+        } else {
+            s.gov_calm = 0.0f;
+        }
+    }
+
+    // Publish the telemetry of a finished render call; returns its load
+    float update_stats(Synth& s, int frames, uint32_t events, double render_us) {
+        SynthStats& st = s.stats;
+        auto relaxed = std::memory_order_relaxed;
+        float deadline_us = (float)(1e6 * frames / s.sr);
+        float load = (float)render_us / deadline_us;
+        int voices = 0;
+        for (uint64_t w : s.voice_used) voices += __builtin_popcountll(w);
+        // Average over about a second of audio
+        float k = (float)frames / (float)s.sr;
+        k = k > 1.0f ? 1.0f : k;
+        float avg = st.load_avg.load(relaxed);
+        st.frames.store((uint32_t)frames, relaxed);
+        st.render_us.store((float)render_us, relaxed);
+        st.deadline_us.store(deadline_us, relaxed);
+        st.load.store(load, relaxed);
+        if (load > st.load_peak.load(relaxed)) st.load_peak.store(load, relaxed);
+        st.load_avg.store(avg + (load - avg) * k, relaxed);
+        st.voices.store((uint32_t)voices, relaxed);
+        if ((uint32_t)voices > st.voices_peak.load(relaxed)) st.voices_peak.store((uint32_t)voices, relaxed);
+        st.events.store(events, relaxed);
+        st.events_total.fetch_add(events, relaxed);
+        if (load > 1.0f) st.overruns.fetch_add(1, relaxed);
+        st.peak.store(s.call_peak, relaxed);
+        st.rms.store(std::sqrt(s.call_sumsq / (float)frames), relaxed);
+        st.renders.fetch_add(1, std::memory_order_release);
+        return load;
+    }
+
+    // Apply events that are due, render up to the next pending one, repeat
+    void render(Synth& s, const RenderOut& o, int frames) {
+#ifdef SYNTH_NO_THREADS
+        // No builder threads: one mip level of one pending user table per call,
+        // taking the tables in turn. It runs before the clock starts, so the
+        // governor does not shed voices for it.
+        for (int k = 0; k < MAX_USER_TABLES; ++k) {
+            int slot = (s.build_next + k) % MAX_USER_TABLES;
+            FrameTable* ft = s.user_tables[slot].table.get();
+            if (ft && frame_table_build_step(*ft)) {
+                s.build_next = (slot + 1) % MAX_USER_TABLES;
+                break;
+            }
+        }
+#endif
+        auto t0 = std::chrono::steady_clock::now();
+        uint32_t events = 0;
+        s.call_peak = 0.0f;
+        s.call_sumsq = 0.0f;
+        if (const SynthPatch* p = s.patches.take()) apply_patch(s, *p);
+        int done = 0;
+        while (done < frames) {
+            int seg = frames - done;
+            while (const SynthEvent* ev = s.events.peek()) {
+                int32_t due = (int32_t)(ev->frame - s.frame);
+                if (due > 0) {
+                    if (due < seg) seg = due;
+                    break;
+                }
+                apply_event(s, *ev);
+                s.events.pop();
+                ++events;
+            }
+            render_segment(s, o, done, seg);
+            done += seg;
+            s.frame += (uint32_t)seg;
+        }
+        double render_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        govern(s, update_stats(s, frames, events, render_us), frames);
     }
 }
 
 extern "C" {
 
-void synth_init(int sample_rate, int table_size) {
-    synth_shutdown();
-    ensure_sp();
-    g_sp->sr = sample_rate;
-    g_table_size = table_size > 64 ? table_size : 2048;
-    rebuild_table_sine(&g_ft1);
-    rebuild_table_sine(&g_ft2);
-    g_master_amp = 0.4f;
-    g_env_atk = 0.01f; g_env_dec = 0.1f; g_env_sus = 0.8f; g_env_rel = 0.2f;
-    g_poly_n = g_poly_n < 1 ? 1 : (g_poly_n > MAX_VOICES ? MAX_VOICES : g_poly_n);
-    init_voices_if_needed();
+Synth* synth_create(int sample_rate, int table_size) {
+    Arena measure;
+    engine_layout(measure);
+    Arena a{static_cast<uint8_t*>(::operator new(measure.used, std::align_val_t(CACHE_LINE)))};
+    std::memset(a.base, 0, measure.used);
+    EngineLayout l = engine_layout(a);
+    Synth* s = new (l.synth) Synth();
+    s->arena_bytes = a.used;
+    s->scratch = l.scratch;
+    for (int i = 0; i <= LFO_TABLE_SIZE; ++i) {
+        l.lfo_sine[i] = (float)std::sin(2.0 * M_PI * (i % LFO_TABLE_SIZE) / LFO_TABLE_SIZE);
+    }
+    s->lfo_sine = l.lfo_sine;
+    synth_init(s, sample_rate, table_size);
+    return s;
+}
+
+void synth_destroy(Synth* s) {
+    if (!s) return;
+    synth_shutdown(s);
+    s->~Synth();
+    ::operator delete(static_cast<void*>(s), std::align_val_t(CACHE_LINE));
+}
+
+void synth_init(Synth* s, int sample_rate, int table_size) {
+    synth_shutdown(s);
+    s->sr = sample_rate > 0 ? sample_rate : 44100;
+    s->table_size = table_size >= 64 ? next_pow2(table_size) : 2048;
+    build_tables(*s);
+    s->master_amp.reset(0.4f);
+    s->env_params = EnvParams{0.01f, 0.1f, 0.8f, 0.2f};
+    s->poly_n = s->poly_n < 1 ? 1 : (s->poly_n > MAX_VOICES ? MAX_VOICES : s->poly_n);
 }
 
-void synth_set_freq(float freq) {
+int synth_memory_bytes(Synth* s) {
+    std::size_t bytes = s->arena_bytes;
+    for (const Synth::UserTable& ut : s->user_tables) {
+        if (ut.table) bytes += frame_table_bytes(*ut.table);
+    }
+    return (int)bytes;
+}
+
+void synth_set_freq(Synth* s, float freq) {
     // Set all active voices to the same freq (legacy support)
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].osc1) g_voices[i].osc1->freq = freq;
-        if (g_voices[i].osc2) g_voices[i].osc2->freq = freq;
+    for (int i = 0; i < s->poly_n; ++i) {
+        Voice& vc = s->voices[i];
+        vc.base_hz = freq > 0.f ? freq : (vc.midi >= 0 ? sp_midi2cps((float)vc.midi) : 440.0f);
     }
 }
 
-void synth_set_amp(float amp) {
-    g_master_amp = amp;
+void synth_set_amp(Synth* s, float amp) {
+    s->master_amp.set(amp, ramp_samples(*s));
+}
+
+void synth_set_smoothing(Synth* s, float ms) {
+    s->smooth_ms = ms < 0.f ? 0.f : ms;
 }
 
-void synth_set_wave(int type) {
-    if (!g_sp) return;
+void synth_set_wave(Synth* s, int type) {
+    if (!s->sr) return;
     // Backwards compatibility: set both oscillators
-    synth_set_wave1(type);
-    synth_set_wave2(type);
-}
-
-void synth_render(float* out_ptr, int frames) {
-    if (!out_ptr || !g_sp) return;
-    float zero = 0.0f, one = 1.0f;
-    for (int i = 0; i < frames; ++i) {
-        // Compute master pitch LFO value and factor
-        float lfo_val = 0.0f;
-        if (g_lfo) sp_osc_compute(g_sp, g_lfo, nullptr, &lfo_val);
-        // LFO routing
-        float pitch_mul = 1.0f;
-        if (g_lfo_dest == 0) { // pitch (semitones)
-            float semi = lfo_val * (g_lfo_amt != 0.0f ? g_lfo_amt : g_lfo_amt_semi);
-            pitch_mul = powf(2.0f, semi / 12.0f);
-        }
-        float cutoff_lfo = (g_lfo_dest == 1) ? (g_lfo_amt * lfo_val) : 0.0f; // Hz
-        float master_amp_mod = (g_lfo_dest == 2) ? (g_lfo_amt * lfo_val) : 0.0f; // linear
-        float res_mod = (g_lfo_dest == 3) ? (g_lfo_amt * lfo_val) : 0.0f; // linear
-        float osc1_gain_mod = (g_lfo_dest == 4) ? (g_lfo_amt * lfo_val) : 0.0f;
-        float osc2_gain_mod = (g_lfo_dest == 5) ? (g_lfo_amt * lfo_val) : 0.0f;
-        float fm1_idx_mod = (g_lfo_dest == 6) ? (g_lfo_amt * lfo_val) : 0.0f;
-        float fm2_idx_mod = (g_lfo_dest == 7) ? (g_lfo_amt * lfo_val) : 0.0f;
-        float mix = 0.0f;
-        for (int v = 0; v < g_poly_n; ++v) {
-            Voice &vc = g_voices[v];
-            if (!vc.active && vc.gate <= 0.f) continue;
-            float s1 = 0.0f, s2 = 0.0f;
-            // Apply LFO and detune per oscillator
-            float base = vc.base_hz > 0.f ? vc.base_hz : (vc.midi >= 0 ? sp_midi2cps((float)vc.midi) : 440.0f);
-            if (vc.osc1 && g_wave1 != 4) {
-                float det1 = powf(2.0f, g_detune1 / 12.0f);
-                vc.osc1->freq = base * pitch_mul * det1;
-                sp_osc_compute(g_sp, vc.osc1, nullptr, &s1);
-            } else if (vc.fosc1 && g_wave1 == 4) {
-                float det1 = powf(2.0f, g_detune1 / 12.0f);
-                vc.fosc1->freq = base * pitch_mul * det1;
-                sp_fosc_compute(g_sp, vc.fosc1, nullptr, &s1);
-            }
-            if (vc.osc2 && g_wave2 != 4) {
-                float det2 = powf(2.0f, g_detune2 / 12.0f);
-                vc.osc2->freq = base * pitch_mul * det2;
-                sp_osc_compute(g_sp, vc.osc2, nullptr, &s2);
-            } else if (vc.fosc2 && g_wave2 == 4) {
-                float det2 = powf(2.0f, g_detune2 / 12.0f);
-                vc.fosc2->freq = base * pitch_mul * det2;
-                sp_fosc_compute(g_sp, vc.fosc2, nullptr, &s2);
-            }
-            float g1 = g_gain1 + osc1_gain_mod; if (g1 < 0.f) g1 = 0.f; if (g1 > 2.f) g1 = 2.f;
-            float g2 = g_gain2 + osc2_gain_mod; if (g2 < 0.f) g2 = 0.f; if (g2 > 2.f) g2 = 2.f;
-            // FM index modulation
-            if (vc.fosc1) { float idx = g_fm1_indx + fm1_idx_mod; if (idx < 0.f) idx = 0.f; vc.fosc1->indx = idx; }
-            if (vc.fosc2) { float idx = g_fm2_indx + fm2_idx_mod; if (idx < 0.f) idx = 0.f; vc.fosc2->indx = idx; }
-            float s = s1 * g1 + s2 * g2;
-            float gate_in = vc.gate > 0.f ? one : zero;
-            // Filter envelope
-            float fenv = 0.0f;
-            if (vc.fenv) sp_adsr_compute(g_sp, vc.fenv, &gate_in, &fenv);
-            // Modulate per-voice filter cutoff
-            if (vc.vcf) {
-                float cutoff = g_fcut + g_fenv_amt * fenv + cutoff_lfo;
-                if (cutoff < 20.0f) cutoff = 20.0f;
-                float nyq = 0.5f * (float)g_sp->sr;
-                if (cutoff > nyq - 100.0f) cutoff = nyq - 100.0f;
-                vc.vcf->freq = cutoff;
-                float rbase = g_fres + res_mod; if (rbase < 0.f) rbase = 0.f; if (rbase > 1.f) rbase = 1.f;
-                float r = rbase;
-                vc.vcf->res = r;
-                float fs = 0.0f;
-                sp_moogladder_compute(g_sp, vc.vcf, &s, &fs);
-                s = fs;
-            }
-            // Amplitude envelope
-            float env = 0.0f;
-            if (vc.env) sp_adsr_compute(g_sp, vc.env, &gate_in, &env);
-            float mg = g_master_amp + master_amp_mod; if (mg < 0.f) mg = 0.f; if (mg > 2.f) mg = 2.f;
-            mix += s * env * (vc.vel * mg);
-            // Auto-deactivate if gate is off and env is near zero
-            if (vc.gate <= 0.f && env < 1e-4f) {
-                vc.active = false;
-                vc.midi = -1;
-                vc.vel = 0.f;
-            }
-        }
-        out_ptr[i] = mix;
-    }
-}
-
-void synth_note_on(int midi_note, float velocity) {
-    ensure_sp();
-    init_voices_if_needed();
-    float freq = sp_midi2cps(static_cast<float>(midi_note));
-    int idx = find_free_voice();
-    Voice &vc = g_voices[idx];
-    if (vc.osc1) vc.osc1->freq = freq;
-    if (vc.osc2) vc.osc2->freq = freq;
-    if (vc.fosc1) vc.fosc1->freq = freq;
-    if (vc.fosc2) vc.fosc2->freq = freq;
-    vc.base_hz = freq;
-    // Update envelope params in case globals changed
-    if (vc.env) { vc.env->atk = g_env_atk; vc.env->dec = g_env_dec; vc.env->sus = g_env_sus; vc.env->rel = g_env_rel; }
-    if (vc.fenv) { vc.fenv->atk = g_fenv_atk; vc.fenv->dec = g_fenv_dec; vc.fenv->sus = g_fenv_sus; vc.fenv->rel = g_fenv_rel; }
-    vc.midi = midi_note;
-    vc.vel = (velocity <= 0.f ? 0.f : (velocity > 1.f ? 1.f : velocity));
-    vc.gate = 1.0f;
-    vc.active = true;
-}
-
-void synth_note_off_midi(int midi_note) {
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].active && g_voices[i].midi == midi_note) {
-            g_voices[i].gate = 0.0f;
-            // remain active until envelope releases
-        }
-    }
-}
-
-void synth_note_off() {
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].active) g_voices[i].gate = 0.0f;
-    }
-}
-
-void synth_shutdown() {
-    free_all_voices();
-    if (g_ft1) { sp_ftbl_destroy(&g_ft1); g_ft1 = nullptr; }
-    if (g_ft2) { sp_ftbl_destroy(&g_ft2); g_ft2 = nullptr; }
-    if (g_lfo) { sp_osc_destroy(&g_lfo); g_lfo = nullptr; }
-    if (g_lfo_ft) { sp_ftbl_destroy(&g_lfo_ft); g_lfo_ft = nullptr; }
-    if (g_sp) {
-        sp_destroy(&g_sp);
-        g_sp = nullptr;
+    synth_set_wave1(s, type);
+    synth_set_wave2(s, type);
+}
+
+void synth_render(Synth* s, float* out_ptr, int frames) {
+    if (!out_ptr || !s->sr || frames <= 0) return;
+    RenderOut o{&out_ptr, 1};
+    render(*s, o, frames);
+}
+
+void synth_render_planar(Synth* s, float* out_ptr, int stride, int channels, int frames, const float* gain,
+                         int gain_count, int accumulate) {
+    if (!out_ptr || !s->sr || channels < 1 || frames <= 0) return;
+    if (channels > MAX_OUT_CHANNELS) channels = MAX_OUT_CHANNELS;
+    float* ch[MAX_OUT_CHANNELS];
+    for (int c = 0; c < channels; ++c) ch[c] = out_ptr + (std::size_t)c * stride;
+    RenderOut o{ch, channels};
+    o.add = accumulate != 0;
+    if (gain && gain_count >= frames) {
+        o.gain = gain;
+    } else if (gain && gain_count == 2) {
+        o.gain0 = gain[0];
+        o.gain_step = frames > 1 ? (gain[1] - gain[0]) / (float)(frames - 1) : 0.0f;
+    } else if (gain && gain_count == 1) {
+        o.gain0 = gain[0];
+    }
+    render(*s, o, frames);
+}
+
+int synth_post_event(Synth* s, uint32_t frame, int type, int i, float a, float b, float c, float d) {
+    return s->events.push(SynthEvent{frame, type, i, a, b, c, d, 0}) ? 1 : 0;
+}
+
+void* synth_event_queue(Synth* s) { return &s->events; }
+
+const void* synth_stats(Synth* s) { return &s->stats; }
+
+int synth_get_state(Synth* s, void* out, int capacity) {
+    if (!out || capacity <= 0) return patch_size();
+    return patch_encode(capture_patch(*s), static_cast<uint8_t*>(out), capacity);
+}
+
+int synth_load_state(Synth* s, const void* data, int size) {
+    SynthPatch& p = s->patches.fill();
+    if (!patch_decode(p, static_cast<const uint8_t*>(data), size)) return 0;
+    s->patches.publish();
+    return 1;
+}
+
+void synth_set_governor(Synth* s, int enabled, float degrade_load, float recover_load) {
+    s->gov_on = enabled != 0;
+    if (degrade_load > 0.0f) s->gov_degrade = degrade_load;
+    if (recover_load > 0.0f) s->gov_recover = recover_load < s->gov_degrade ? recover_load : s->gov_degrade;
+    s->gov_load = 0.0f;
+    s->gov_hold = 0.0f;
+    s->gov_calm = 0.0f;
+}
+
+void synth_set_governor_limits(Synth* s, float cull_level, int min_poly) {
+    if (cull_level >= 0.0f) s->gov_cull = cull_level;
+    if (min_poly > 0) s->gov_min_poly = min_poly > MAX_VOICES ? MAX_VOICES : min_poly;
+}
+
+void synth_set_quality(Synth* s, int level) { set_quality(*s, level); }
+int synth_get_quality(Synth* s) { return s->quality; }
+
+void synth_stats_reset(Synth* s) {
+    SynthStats& st = s->stats;
+    auto relaxed = std::memory_order_relaxed;
+    st.load_peak.store(0.0f, relaxed);
+    st.voices_peak.store(0, relaxed);
+    st.steals.store(0, relaxed);
+    st.events_total.store(0, relaxed);
+    st.nan_blocks.store(0, relaxed);
+    st.denormal_blocks.store(0, relaxed);
+    st.overruns.store(0, relaxed);
+    st.dropouts.store(0, relaxed);
+}
+void synth_set_frame(Synth* s, uint32_t frame) {
+    // A host timeline that skips ahead between renders means audio was lost
+    // (e.g. the audio thread missed callbacks)
+    if (s->stats.renders.load(std::memory_order_relaxed) > 0 && (int32_t)(frame - s->frame) > 0) {
+        s->stats.dropouts.fetch_add(1, std::memory_order_relaxed);
+    }
+    s->frame = frame;
+}
+uint32_t synth_get_frame(Synth* s) { return s->frame; }
+
+void synth_set_threads(Synth* s, int threads, int min_voices_per_thread) {
+    threads = threads < 1 ? 1 : (threads > MAX_RENDER_THREADS ? MAX_RENDER_THREADS : threads);
+    if (threads > 1) WorkerPool::instance().reserve(threads);
+    // Fewer threads when the pool cannot start them (WASM without pthreads)
+    if (threads > WorkerPool::instance().size()) threads = WorkerPool::instance().size();
+    s->threads = threads;
+    s->min_voices_per_thread = min_voices_per_thread < 1 ? 1 : min_voices_per_thread;
+}
+
+void synth_note_on(Synth* s, int midi_note, float velocity) {
+    float vel = velocity <= 0.f ? 0.f : (velocity > 1.f ? 1.f : velocity);
+    int idx = find_free_voice(*s);
+    if (idx >= 0) start_voice(*s, idx, midi_note, vel);
+    else steal_voice(*s, midi_note, vel);
+}
+
+void synth_note_off_midi(Synth* s, int midi_note) {
+    for (int v = next_used_voice(*s, 0); v < MAX_VOICES; v = next_used_voice(*s, v + 1)) {
+        Voice& vc = s->voices[v];
+        // A note released before its steal fade ended never starts
+        if (vc.pending_midi == midi_note) vc.pending_midi = -1;
+        // remain active until envelope releases
+        else if (vc.midi == midi_note) vc.gate = 0.0f;
+    }
+}
+
+void synth_note_off(Synth* s) {
+    for (int v = next_used_voice(*s, 0); v < MAX_VOICES; v = next_used_voice(*s, v + 1)) {
+        s->voices[v].gate = 0.0f;
+        s->voices[v].pending_midi = -1;
     }
 }
 
+int synth_active_voices(Synth* s) {
+    int n = 0;
+    for (uint64_t bits : s->voice_used) n += __builtin_popcountll(bits);
+    return n;
+}
+
+void synth_shutdown(Synth* s) {
+    for (int i = 0; i < MAX_USER_TABLES; ++i) release_user_table(*s, i);
+    free_all_voices(*s);
+    for (Synth::Lfo& l : s->lfo) l.phase = l.last = 0.0f;
+    s->events.clear();
+    s->frame = 0;
+    s->sr = 0;
+}
+
 } // extern "C"
 
 extern "C" {
 // Additional controls
-void synth_set_env(float atk, float dec, float sus, float rel) {
-    g_env_atk = atk; g_env_dec = dec; g_env_sus = sus; g_env_rel = rel;
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].env) {
-            g_voices[i].env->atk = g_env_atk;
-            g_voices[i].env->dec = g_env_dec;
-            g_voices[i].env->sus = g_env_sus;
-            g_voices[i].env->rel = g_env_rel;
-        }
-    }
+void synth_set_env(Synth* s, float atk, float dec, float sus, float rel) {
+    s->env_params = EnvParams{atk, dec, sus, rel};
 }
 
-void synth_set_poly(int n) {
+void synth_set_poly(Synth* s, int n) {
     if (n < 1) n = 1; if (n > MAX_VOICES) n = MAX_VOICES;
-    g_poly_n = n;
-    init_voices_if_needed();
+    s->poly_n = n;
+    // Slots above the new limit stop at once
+    for (int v = next_used_voice(*s, n); v < MAX_VOICES; v = next_used_voice(*s, v + 1)) free_voice(*s, v);
 }
 
 // LFO controls
-void synth_lfo_set(float rate_hz) {
-    g_lfo_rate = rate_hz;
-    if (g_lfo) g_lfo->freq = g_lfo_rate;
+void synth_lfo_set(Synth* s, float rate_hz) {
+    s->lfo[0].rate = rate_hz;
+}
+
+void synth_lfo_amount_semi(Synth* s, float amt_semi) {
+    s->lfo_amt_semi = amt_semi;
+    s->lfo_depth.set(lfo_depth_target(*s), ramp_samples(*s));
+}
+
+// Switching destination is immediate; the new depth is not ramped from the old one
+void synth_lfo_dest(Synth* s, int dest) { s->lfo_dest = dest; s->lfo_depth.reset(lfo_depth_target(*s)); }
+void synth_lfo_amount(Synth* s, float amount) { s->lfo_amt = amount; s->lfo_depth.set(lfo_depth_target(*s), ramp_samples(*s)); }
+
+// Modulation matrix
+void synth_mod_route(Synth* s, int slot, int source, int dest, float amount) {
+    if (slot < 0 || slot >= SYNTH_MOD_ROUTES) return;
+    Synth::ModRoute& r = s->routes[slot];
+    bool valid = source >= 0 && source < SYNTH_MOD_SOURCES && dest >= 0 && dest < SYNTH_MOD_DESTS;
+    r.source = valid ? source : -1;
+    r.dest = valid ? dest : 0;
+    r.amount = valid ? amount : 0.0f;
+    s->routes_changed = true;
 }
 
-void synth_lfo_amount_semi(float amt_semi) {
-    g_lfo_amt_semi = amt_semi;
+void synth_mod_lfo(Synth* s, int lfo, float rate_hz, int shape) {
+    if (lfo < 1 || lfo > MOD_LFOS) return;
+    Synth::Lfo& l = s->lfo[lfo - 1];
+    l.rate = rate_hz < 0.f ? 0.f : rate_hz;
+    l.shape = shape < SYNTH_LFO_SINE || shape > SYNTH_LFO_SQUARE ? SYNTH_LFO_SINE : shape;
 }
 
-void synth_lfo_dest(int dest) { g_lfo_dest = dest; }
-void synth_lfo_amount(float amount) { g_lfo_amt = amount; }
+void synth_mod_wheel(Synth* s, float value) { s->mod_wheel.set(clampf(value, 0.f, 1.f), ramp_samples(*s)); }
 
 // Filter controls
-void synth_filter_set(float cutoff_hz, float resonance) {
-    g_fcut = cutoff_hz;
-    g_fres = resonance;
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].vcf) { g_voices[i].vcf->freq = g_fcut; g_voices[i].vcf->res = g_fres; }
-    }
+void synth_filter_set(Synth* s, float cutoff_hz, float resonance) {
+    s->fcut.set(cutoff_hz, ramp_samples(*s));
+    s->fres.set(resonance, ramp_samples(*s));
 }
 
-void synth_filter_env(float atk, float dec, float sus, float rel) {
-    g_fenv_atk = atk; g_fenv_dec = dec; g_fenv_sus = sus; g_fenv_rel = rel;
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (g_voices[i].fenv) { g_voices[i].fenv->atk = atk; g_voices[i].fenv->dec = dec; g_voices[i].fenv->sus = sus; g_voices[i].fenv->rel = rel; }
-    }
+void synth_filter_env(Synth* s, float atk, float dec, float sus, float rel) {
+    s->fenv_params = EnvParams{atk, dec, sus, rel};
 }
 
-void synth_filter_env_amount(float amt_hz) { g_fenv_amt = amt_hz; }
+void synth_filter_env_amount(Synth* s, float amt_hz) { s->fenv_amt.set(amt_hz, ramp_samples(*s)); }
+void synth_filter_enable(Synth* s, int enabled) { s->filter_on = enabled != 0; }
+
+void synth_filter_mode(Synth* s, int mode) {
+    mode = mode < 0 || mode >= FILTER_MODES ? FILTER_LADDER : mode;
+    if (mode == s->filter_mode) return;
+    // The ladders keep separate state; start the new one from silence (the
+    // ZDF ladder and SVF share theirs, but read it differently)
+    if (mode == FILTER_LADDER) {
+        ladder_reset(s->vcf);
+        ladder_reset(s->vcf_side);
+    } else if ((mode == FILTER_SVF) != (s->filter_mode == FILTER_SVF) || s->filter_mode == FILTER_LADDER) {
+        zdf_reset(s->zdf);
+        zdf_reset(s->zdf_side);
+    }
+    s->filter_mode = mode;
+}
 }
 
 // New oscillator controls
 extern "C" {
-void synth_set_wave1(int type) {
-    if (!g_sp) return;
-    if (type == 4) { // FM
-        // ensure fm uses sine table; nothing to rebuild
-    } else {
-        if (g_ft1) { sp_ftbl_destroy(&g_ft1); g_ft1 = nullptr; }
-        switch (type) {
-            case 1: rebuild_table_saw(&g_ft1); break;
-            case 2: rebuild_table_square(&g_ft1); break;
-            case 3: rebuild_table_triangle(&g_ft1); break;
-            case 0: default: rebuild_table_sine(&g_ft1); break;
-        }
-    }
-    g_wave1 = type;
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (type == 4) {
-            // switch to FM: nothing to reinit here (already created), ensure sine ft exists
-            if (!g_lfo_ft) { sp_ftbl_create(g_sp, &g_lfo_ft, 2048); sp_gen_sine(g_sp, g_lfo_ft); }
-            if (g_voices[i].fosc1 && g_voices[i].fosc1->ft != g_lfo_ft) {
-                // no direct setter; re-init
-                sp_fosc_init(g_sp, g_voices[i].fosc1, g_lfo_ft);
-            }
-        } else if (g_voices[i].osc1) {
-            float a = g_voices[i].osc1->amp, f = g_voices[i].osc1->freq;
-            sp_osc_destroy(&g_voices[i].osc1);
-            sp_osc_create(&g_voices[i].osc1);
-            sp_osc_init(g_sp, g_voices[i].osc1, g_ft1, 0);
-            g_voices[i].osc1->amp = a; g_voices[i].osc1->freq = f;
-        }
-    }
-}
-void synth_set_wave2(int type) {
-    if (!g_sp) return;
-    if (type == 4) {
-        // FM
-    } else {
-        if (g_ft2) { sp_ftbl_destroy(&g_ft2); g_ft2 = nullptr; }
-        switch (type) {
-            case 1: rebuild_table_saw(&g_ft2); break;
-            case 2: rebuild_table_square(&g_ft2); break;
-            case 3: rebuild_table_triangle(&g_ft2); break;
-            case 0: default: rebuild_table_sine(&g_ft2); break;
-        }
-    }
-    g_wave2 = type;
-    for (int i = 0; i < g_poly_n; ++i) {
-        if (type == 4) {
-            if (!g_lfo_ft) { sp_ftbl_create(g_sp, &g_lfo_ft, 2048); sp_gen_sine(g_sp, g_lfo_ft); }
-            if (g_voices[i].fosc2 && g_voices[i].fosc2->ft != g_lfo_ft) {
-                sp_fosc_init(g_sp, g_voices[i].fosc2, g_lfo_ft);
-            }
-        } else if (g_voices[i].osc2) {
-            float a = g_voices[i].osc2->amp, f = g_voices[i].osc2->freq;
-            sp_osc_destroy(&g_voices[i].osc2);
-            sp_osc_create(&g_voices[i].osc2);
-            sp_osc_init(g_sp, g_voices[i].osc2, g_ft2, 0);
-            g_voices[i].osc2->amp = a; g_voices[i].osc2->freq = f;
-        }
-    }
-}
-void synth_set_detune1(float semi) { g_detune1 = semi; }
-void synth_set_detune2(float semi) { g_detune2 = semi; }
-void synth_set_gain1(float g) { g_gain1 = g; }
-void synth_set_gain2(float g) { g_gain2 = g; }
-
-// FM parameter setters (per-oscillator)
-void synth_fm1(float car, float mod, float indx) {
-    g_fm1_car = car; g_fm1_mod = mod; g_fm1_indx = indx;
-    for (int i = 0; i < g_poly_n; ++i) if (g_voices[i].fosc1) {
-        g_voices[i].fosc1->car = g_fm1_car;
-        g_voices[i].fosc1->mod = g_fm1_mod;
-        g_voices[i].fosc1->indx = g_fm1_indx;
-    }
-}
-void synth_fm2(float car, float mod, float indx) {
-    g_fm2_car = car; g_fm2_mod = mod; g_fm2_indx = indx;
-    for (int i = 0; i < g_poly_n; ++i) if (g_voices[i].fosc2) {
-        g_voices[i].fosc2->car = g_fm2_car;
-        g_voices[i].fosc2->mod = g_fm2_mod;
-        g_voices[i].fosc2->indx = g_fm2_indx;
+// Tables for every shape are prebuilt; switching only selects one
+void synth_set_wave1(Synth* s, int type) {
+    if (!s->sr) return;
+    switch_shape(*s, s->osc1, type);
+}
+void synth_set_wave2(Synth* s, int type) {
+    if (!s->sr) return;
+    switch_shape(*s, s->osc2, type);
+}
+void synth_set_wave_crossfade(Synth* s, float ms) { s->wave_fade_ms = ms < 0.f ? 0.f : ms; }
+void synth_set_position1(Synth* s, float pos) { s->pos1.set(clampf(pos, 0.f, 1.f), ramp_samples(*s)); }
+void synth_set_position2(Synth* s, float pos) { s->pos2.set(clampf(pos, 0.f, 1.f), ramp_samples(*s)); }
+
+void synth_set_pan(Synth* s, float pan) { s->pan = clampf(pan, -1.f, 1.f); }
+void synth_set_spread(Synth* s, float spread) { s->spread = clampf(spread, 0.f, 1.f); }
+
+void synth_unison(Synth* s, int osc, int voices, float detune, float curve, float width) {
+    if (osc < 1 || osc > 2) return;
+    Synth::Unison& u = s->unison[osc - 1];
+    int before = u.voices;
+    u.voices = voices < 1 ? 1 : (voices > MAX_UNISON ? MAX_UNISON : voices);
+    u.detune = clampf(detune, 0.f, 12.f);
+    u.curve = clampf(curve, 0.f, 1.f);
+    u.width = clampf(width, 0.f, 1.f);
+    unison_layout(u);
+    // Sounding notes pick up added copies at their fixed offsets; a stack
+    // switched on takes over from the single oscillator's phase
+    float* single = osc == 1 ? s->phase1 : s->phase2;
+    for (int c = before > 1 ? before : 0; c < u.voices; ++c) {
+        for (int v = 0; v < MAX_VOICES; ++v) {
+            float p = (before > 1 ? 0.0f : single[v]) + u.offset[c];
+            s->uphase[osc - 1][c][v] = p - std::floor(p);
+        }
     }
 }
+
+void synth_unison_phase(Synth* s, int osc, float random) {
+    if (osc < 1 || osc > 2) return;
+    s->unison[osc - 1].random = clampf(random, 0.f, 1.f);
+}
+
+int synth_wavetable_create(Synth* s, const float* data, int frames, int frame_size) {
+    if (!data || frames < 1 || frames > MAX_USER_FRAMES) return -1;
+    if (frame_size < 64 || frame_size > 16384 || next_pow2(frame_size) != frame_size) return -1;
+    int slot = 0;
+    while (slot < MAX_USER_TABLES && s->user_tables[slot].table) ++slot;
+    if (slot == MAX_USER_TABLES) return -1;
+    Synth::UserTable& ut = s->user_tables[slot];
+    ut.table.reset(new FrameTable());
+    frame_table_init(*ut.table, data, frames, frame_size);
+#ifndef SYNTH_NO_THREADS
+    FrameTable* ft = ut.table.get();
+    ut.builder = std::thread([ft] {
+        while (!ft->cancel.load(std::memory_order_relaxed) && frame_table_build_step(*ft)) {}
+    });
+#endif
+    return WAVE_USER_BASE + slot;
+}
+
+void synth_wavetable_release(Synth* s, int wave) {
+    if (!user_table(*s, wave)) return;
+    release_user_table(*s, wave - WAVE_USER_BASE);
+}
+
+int synth_wavetable_in_use(Synth* s, int wave) {
+    if (!user_table(*s, wave)) return 0;
+    for (const OscShape* o : {&s->osc1, &s->osc2}) {
+        if (o->wave == wave || o->from == wave) return 1;
+    }
+    return 0;
+}
+
+int synth_wavetable_ready(Synth* s, int wave) {
+    const FrameTable* ft = user_table(*s, wave);
+    return ft && ft->built.load(std::memory_order_acquire) == ft->frames ? 1 : 0;
+}
+void synth_set_detune1(Synth* s, float semi) { s->detune1 = semi; s->det1_ratio.set(powf(2.0f, semi / 12.0f), ramp_samples(*s)); }
+void synth_set_detune2(Synth* s, float semi) { s->detune2 = semi; s->det2_ratio.set(powf(2.0f, semi / 12.0f), ramp_samples(*s)); }
+void synth_set_gain1(Synth* s, float g) { s->gain1.set(g, ramp_samples(*s)); }
+void synth_set_gain2(Synth* s, float g) { s->gain2.set(g, ramp_samples(*s)); }
+
+// FM parameter setters (per-oscillator): the two-operator controls set the
+// ratios of operators 1 and 2
+void synth_fm1(Synth* s, float car, float mod, float indx) {
+    s->fm_patch[0].op[0].ratio = car;
+    s->fm_patch[0].op[1].ratio = mod;
+    s->fm1_indx.set(indx, ramp_samples(*s));
+}
+void synth_fm2(Synth* s, float car, float mod, float indx) {
+    s->fm_patch[1].op[0].ratio = car;
+    s->fm_patch[1].op[1].ratio = mod;
+    s->fm2_indx.set(indx, ramp_samples(*s));
+}
+
+void synth_fm_algorithm(Synth* s, int osc, int algorithm) {
+    if (osc < 1 || osc > 2) return;
+    s->fm_patch[osc - 1].algorithm = algorithm < 0 || algorithm >= FM_ALGORITHMS ? 0 : algorithm;
+}
+
+void synth_fm_feedback(Synth* s, int osc, float amount) {
+    if (osc < 1 || osc > 2) return;
+    s->fm_patch[osc - 1].feedback = clampf(amount, 0.f, 1.f);
+}
+
+void synth_fm_op(Synth* s, int osc, int op, float ratio, float level) {
+    if (osc < 1 || osc > 2 || op < 1 || op > FM_OPS) return;
+    FmOp& o = s->fm_patch[osc - 1].op[op - 1];
+    o.ratio = ratio < 0.f ? 0.f : ratio;
+    o.level = level;
+}
+
+void synth_fm_op_env(Synth* s, int osc, int op, float atk, float dec, float sus, float rel) {
+    if (osc < 1 || osc > 2 || op < 1 || op > FM_OPS) return;
+    FmOp& o = s->fm_patch[osc - 1].op[op - 1];
+    // Held notes run a newly enabled envelope from its attack
+    if (atk >= 0.f && !o.env_on) env_reset(s->fm[osc - 1].env[op - 1]);
+    o.env_on = atk >= 0.f;
+    if (o.env_on) o.env = EnvParams{atk, dec, sus, rel};
+}
 }
@@ -3,59 +3,298 @@
 #include <cstdint>
 
 extern "C" {
-// Initialize the synth. Creates Soundpipe context, table, and oscillator.
+// Engine instance. Every call takes the handle; instances are independent and
+// share only the read-only built-in wavetables, so one module can host many
+// (e.g. one per MIDI channel). A single instance is not thread-safe, apart from
+// synth_post_event (one producer) alongside rendering.
+typedef struct Synth Synth;
+
+// Create an initialized engine / destroy it and free everything it owns.
 // sample_rate: e.g., 44100 or 48000
 // table_size: size of wavetable (power of two recommended, e.g., 2048)
-void synth_init(int sample_rate, int table_size);
+Synth* synth_create(int sample_rate, int table_size);
+void synth_destroy(Synth* s);
+
+// Re-initialize an existing engine in place (voices and DSP state reset)
+void synth_init(Synth* s, int sample_rate, int table_size);
+
+// Bytes of memory the engine owns: the arena synth_create carves all voice
+// and DSP state from (sized by the polyphony limit; polyphony changes and
+// patch loads never allocate) plus the mip levels of its user wavetables.
+// The built-in tables are shared by every engine and not counted.
+int synth_memory_bytes(Synth* s);
 
 // Set basic parameters
-void synth_set_freq(float freq);
-void synth_set_amp(float amp);
+void synth_set_freq(Synth* s, float freq);
+void synth_set_amp(Synth* s, float amp);
+// Ramp time (ms) for amp, gains, detune, filter, FM index and LFO depth changes; 0 = immediate
+void synth_set_smoothing(Synth* s, float ms);
 
 // Set waveform type
 // 0 = sine, 1 = saw, 2 = square, 3 = triangle
-void synth_set_wave(int type);
+void synth_set_wave(Synth* s, int type);
+
+// Render 'frames' mono samples into memory pointed by 'out_ptr' (float*).
+// Queued events are applied at their exact frame, splitting the block.
+void synth_render(Synth* s, float* out_ptr, int frames);
+
+// Render 'frames' samples into 'channels' planar buffers, channel c starting at
+// out_ptr + c * stride floats. Voices are placed by synth_set_pan/spread;
+// channel 0 is left, 1 right, and further channels repeat the pair (a single
+// channel gets the mono mix). gain scales the output: gain_count == frames
+// gives one value per frame, 2 a linear ramp from gain[0] to gain[1], 1 a
+// constant, 0 (or gain == NULL) unity. accumulate != 0 adds into the buffers,
+// so several engines can mix into one output.
+void synth_render_planar(Synth* s, float* out_ptr, int stride, int channels, int frames, const float* gain,
+                         int gain_count, int accumulate);
+
+// Event queue: timestamped note/parameter changes applied sample-accurately by
+// synth_render. Field use per type (i = int, a..d = floats):
+enum SynthEventType {
+    SYNTH_EV_NOTE_ON = 1,             // i = midi note, a = velocity
+    SYNTH_EV_NOTE_OFF = 2,            // i = midi note, or -1 for all notes
+    SYNTH_EV_AMP = 3,                 // a
+    SYNTH_EV_WAVE = 4,                // i, both oscillators
+    SYNTH_EV_WAVE1 = 5,               // i
+    SYNTH_EV_WAVE2 = 6,               // i
+    SYNTH_EV_DETUNE1 = 7,             // a = semitones
+    SYNTH_EV_DETUNE2 = 8,             // a = semitones
+    SYNTH_EV_GAIN1 = 9,               // a
+    SYNTH_EV_GAIN2 = 10,              // a
+    SYNTH_EV_FM1 = 11,                // a = car, b = mod, c = index
+    SYNTH_EV_FM2 = 12,                // a = car, b = mod, c = index
+    SYNTH_EV_ENV = 13,                // a..d = attack, decay, sustain, release
+    SYNTH_EV_POLY = 14,               // i
+    SYNTH_EV_FILTER = 15,             // a = cutoff Hz, b = resonance
+    SYNTH_EV_FILTER_ENV = 16,         // a..d = attack, decay, sustain, release
+    SYNTH_EV_FILTER_ENV_AMOUNT = 17,  // a = Hz
+    SYNTH_EV_FILTER_ENABLE = 18,      // i
+    SYNTH_EV_LFO_RATE = 19,           // a = Hz
+    SYNTH_EV_LFO_DEST = 20,           // i
+    SYNTH_EV_LFO_AMOUNT = 21,         // a
+    SYNTH_EV_SMOOTHING = 22,          // a = ms
+    SYNTH_EV_WAVE_CROSSFADE = 23,     // a = ms
+    SYNTH_EV_POSITION1 = 24,          // a = 0..1
+    SYNTH_EV_POSITION2 = 25,          // a = 0..1
+    SYNTH_EV_PAN = 26,                // a = -1..1
+    SYNTH_EV_SPREAD = 27,             // a = 0..1
+    SYNTH_EV_FILTER_MODE = 28,        // i
+    SYNTH_EV_FM_ALGORITHM = 29,       // i = oscillator, a = algorithm
+    SYNTH_EV_FM_FEEDBACK = 30,        // i = oscillator, a = amount
+    SYNTH_EV_FM_OP = 31,              // i = (osc - 1) * 4 + op - 1, a = ratio, b = level
+    SYNTH_EV_FM_OP_ENV = 32,          // i as FM_OP, a..d = attack, decay, sustain, release
+    SYNTH_EV_UNISON = 33,             // i = oscillator, a = voices, b = detune, c = curve, d = width
+    SYNTH_EV_UNISON_PHASE = 34,       // i = oscillator, a = randomness
+    SYNTH_EV_MOD_ROUTE = 35,          // i = slot, a = source, b = destination, c = amount
+    SYNTH_EV_MOD_LFO = 36,            // i = LFO (1..3), a = Hz, b = shape
+    SYNTH_EV_MOD_WHEEL = 37           // a = 0..1
+};
+// Queue an event for engine frame 'frame' (0 or any past frame = next render).
+// Returns 0 if the queue is full. Safe to call from one producer thread while
+// another renders.
+int synth_post_event(Synth* s, uint32_t frame, int type, int i, float a, float b, float c, float d);
+// Address of the event ring (EventQueue in event_queue.h), for hosts that write
+// events straight into engine memory instead of calling synth_post_event
+void* synth_event_queue(Synth* s);
+// Engine clock in frames; advanced by synth_render. Hosts with their own
+// timeline (e.g. AudioWorklet currentFrame) set it before rendering.
+void synth_set_frame(Synth* s, uint32_t frame);
+uint32_t synth_get_frame(Synth* s);
+
+// Telemetry: address of the engine's SynthStats block (synth_stats.h), updated
+// lock-free after every render call with render time against the block
+// deadline, DSP load, voices, steals, events, NaN/denormal detections and
+// overruns/dropouts. Poll it from any thread, or read it from the WASM heap.
+const void* synth_stats(Synth* s);
+// Clear the peaks and counters (render time, load and level keep updating)
+void synth_stats_reset(Synth* s);
+
+// Patch snapshots: every sound setting (oscillators, FM operators, envelopes,
+// filter, LFO, stereo, polyphony) as a compact versioned binary blob, see
+// synth_patch.h for the format. synth_get_state writes the current patch to
+// out and returns its size, or returns the size needed without writing when
+// capacity is short (0 asks for it). Call it from the rendering thread or
+// while no render is running.
+int synth_get_state(Synth* s, void* out, int capacity);
+// Decode a snapshot and apply it whole at the start of the next render call:
+// parameters glide together over its smoothing time and shapes crossfade, with
+// no table builds or allocation. Decoding happens here, on the caller, so it
+// is safe from one producer thread while another renders; if several loads
+// arrive between two renders the last one wins. Returns 0 for a blob that is
+// not a patch, is truncated or is from a newer version.
+int synth_load_state(Synth* s, const void* data, int size);
 
-// Render 'frames' mono samples into memory pointed by 'out_ptr' (float*)
-void synth_render(float* out_ptr, int frames);
+// CPU governor for realtime hosts (off by default). Each render measures its
+// own load (render time / block duration); while the load, smoothed over
+// ~50 ms, stays above degrade_load the engine drops one quality level every
+// 100 ms, and it climbs back one level per second of load below recover_load.
+// Levels: 1 fades out releasing voices below the audibility threshold, 2 runs
+// control signals (LFO, mip selection, filter coefficients) once per 64-frame
+// block, 3 runs the filter without oversampling, 4 caps polyphony. Thresholds <= 0 keep
+// their current values (defaults 0.85 and 0.5).
+void synth_set_governor(Synth* s, int enabled, float degrade_load, float recover_load);
+// cull_level: linear envelope * velocity under which releasing voices are cut
+// at level 1 (default 0.001, -60 dB; < 0 keeps it). min_poly: the level 4 cap
+// is half the polyphony but at least this many voices (default 8; <= 0 keeps it).
+void synth_set_governor_limits(Synth* s, float cull_level, int min_poly);
+// Quality level 0 (full) .. 4. Setting it pins the level while the governor is
+// off (e.g. a known-slow device), or gives it a starting point.
+void synth_set_quality(Synth* s, int level);
+int synth_get_quality(Synth* s);
+
+// Parallel voice rendering. Voice groups (SIMD_WIDTH voices each) are spread
+// over up to 'threads' workers (at most 16) from a process-wide pool, the
+// calling thread included. Each block uses one thread per min_voices_per_thread sounding
+// voices (so quiet passages stay on the caller). Output is identical
+// for any thread count. threads <= 1 (the default) renders on the caller only.
+// Starts pool threads, so call it at setup, not from the audio callback.
+void synth_set_threads(Synth* s, int threads, int min_voices_per_thread);
 
 // Simple MIDI helpers
-void synth_note_on(int midi_note, float velocity);
-void synth_note_off();
+void synth_note_on(Synth* s, int midi_note, float velocity);
+void synth_note_off(Synth* s);
 // Polyphonic note off by MIDI note number
-void synth_note_off_midi(int midi_note);
+void synth_note_off_midi(Synth* s, int midi_note);
+
+// Voices currently sounding (held or releasing)
+int synth_active_voices(Synth* s);
 
 // Envelope: attack, decay, sustain, release (seconds, sustain 0..1)
-void synth_set_env(float attack, float decay, float sustain, float release);
+void synth_set_env(Synth* s, float attack, float decay, float sustain, float release);
 
-// Polyphony: number of voices (1..16)
-void synth_set_poly(int nvoices);
+// Polyphony: number of voices (1..128). When all are busy a new note steals
+// one (released first, then quietest, then oldest) after a ~3 ms fade-out.
+void synth_set_poly(Synth* s, int nvoices);
 
 // Filter: Moog ladder with cutoff (Hz) and resonance (0..1)
-void synth_filter_set(float cutoff_hz, float resonance);
+void synth_filter_set(Synth* s, float cutoff_hz, float resonance);
+// Filter mode: 0 = Huovilainen ladder, 2x oversampled (default, the reference
+// sound), 1 = zero-delay-feedback ladder with control-rate coefficients (about
+// a quarter of the cost, stable up to res = 1), 2 = the ZDF ladder 2x oversampled (cleaner at high
+// resonance and cutoff), 3 = ZDF state-variable 12 dB lowpass (cheapest).
+// Switching restarts the filter state.
+void synth_filter_mode(Synth* s, int mode);
 // Filter envelope ADSR
-void synth_filter_env(float attack, float decay, float sustain, float release);
+void synth_filter_env(Synth* s, float attack, float decay, float sustain, float release);
 // Filter env amount in Hz (added to cutoff when env=1)
-void synth_filter_env_amount(float amount_hz);
+void synth_filter_env_amount(Synth* s, float amount_hz);
+// Bypass (0) or enable (1) the per-voice filter stage
+void synth_filter_enable(Synth* s, int enabled);
 
 // LFO: master pitch modulation
-void synth_lfo_set(float rate_hz);
-void synth_lfo_amount_semi(float amount_semitones);
-void synth_lfo_dest(int dest);
-void synth_lfo_amount(float amount);
+void synth_lfo_set(Synth* s, float rate_hz);
+void synth_lfo_amount_semi(Synth* s, float amount_semitones);
+void synth_lfo_dest(Synth* s, int dest);
+void synth_lfo_amount(Synth* s, float amount);
+
+// Modulation matrix: up to SYNTH_MOD_ROUTES routes, each adding amount *
+// source to a destination (units as the LFO amount: semitones for pitch, Hz
+// for cutoff, plain values otherwise). The classic LFO above is a route of its
+// own from LFO 1. Global sources run once per block for all voices; per-voice
+// sources are read once per block for each voice and reach pitch, cutoff,
+// amp and the oscillator gains (their routes to other destinations are
+// ignored). Changed routes take effect at the next block.
+enum { SYNTH_MOD_ROUTES = 16 };
+enum SynthModSource {
+    SYNTH_MOD_LFO1 = 0,       // -1..1 (the classic LFO)
+    SYNTH_MOD_LFO2 = 1,
+    SYNTH_MOD_LFO3 = 2,
+    SYNTH_MOD_WHEEL = 3,      // 0..1, smoothed
+    SYNTH_MOD_AMP_ENV = 4,    // per voice from here: 0..1
+    SYNTH_MOD_FILTER_ENV = 5, // 0..1
+    SYNTH_MOD_VELOCITY = 6,   // 0..1
+    SYNTH_MOD_KEY = 7,        // octaves from middle C
+    SYNTH_MOD_SOURCES = 8
+};
+// Destinations, numbered as synth_lfo_dest
+enum SynthModDest {
+    SYNTH_MOD_PITCH = 0, SYNTH_MOD_CUTOFF = 1, SYNTH_MOD_AMP = 2, SYNTH_MOD_RES = 3,
+    SYNTH_MOD_GAIN1 = 4, SYNTH_MOD_GAIN2 = 5, SYNTH_MOD_FM1_INDEX = 6, SYNTH_MOD_FM2_INDEX = 7,
+    SYNTH_MOD_POSITION1 = 8, SYNTH_MOD_POSITION2 = 9, SYNTH_MOD_DESTS = 10
+};
+enum { SYNTH_LFO_SINE = 0, SYNTH_LFO_TRIANGLE = 1, SYNTH_LFO_SAW = 2, SYNTH_LFO_SQUARE = 3 };
+// Set route slot 0..SYNTH_MOD_ROUTES-1; a negative source (or amount 0) empties it
+void synth_mod_route(Synth* s, int slot, int source, int dest, float amount);
+// Rate (Hz) and shape of LFO 1..3; LFO 1's rate is also synth_lfo_set
+void synth_mod_lfo(Synth* s, int lfo, float rate_hz, int shape);
+// Mod wheel position, 0..1
+void synth_mod_wheel(Synth* s, float value);
 
 // Oscillator controls (two oscillators)
-void synth_set_wave1(int type);
-void synth_set_wave2(int type);
-void synth_set_detune1(float semi);
-void synth_set_detune2(float semi);
-void synth_set_gain1(float gain);
-void synth_set_gain2(float gain);
-
-// FM controls
-void synth_fm1(float car, float mod, float index);
-void synth_fm2(float car, float mod, float index);
-
-// Cleanup resources
-void synth_shutdown();
+void synth_set_wave1(Synth* s, int type);
+void synth_set_wave2(Synth* s, int type);
+// Crossfade time (ms) when an oscillator changes shape; 0 = hard switch.
+// Switching never allocates and keeps the oscillator phase.
+void synth_set_wave_crossfade(Synth* s, float ms);
+void synth_set_detune1(Synth* s, float semi);
+void synth_set_detune2(Synth* s, float semi);
+void synth_set_gain1(Synth* s, float gain);
+void synth_set_gain2(Synth* s, float gain);
+
+// User wavetables: 'frames' (1..256) single cycles of frame_size samples (a
+// power of two, 64..16384), stored frame after frame at 'data', e.g. a buffer
+// the host allocated in the WASM heap. The engine reads the samples in place
+// and never copies or frees them, so keep them alive and unchanged until
+// synth_wavetable_release. Returns a wave number (8..15) for synth_set_wave1/2,
+// or -1 for bad sizes or when all 8 slots are taken.
+// Band-limited mip levels are built in the background (a thread per table, or
+// in WASM builds without threads one mip level of one table per synth_render
+// call, outside the load the governor measures); until a frame is ready it
+// plays from the raw samples, which alias on high notes.
+int synth_wavetable_create(Synth* s, const float* data, int frames, int frame_size);
+// Forget a table; oscillators still set to it play a sine
+void synth_wavetable_release(Synth* s, int wave);
+// 1 while an oscillator plays the table or is still crossfading from it: a
+// host replacing a table releases the old one once this drops to 0
+int synth_wavetable_in_use(Synth* s, int wave);
+// 1 once every frame of the table is band-limited
+int synth_wavetable_ready(Synth* s, int wave);
+// Position (0..1) across the frames of the oscillator's user table; frames
+// are morphed linearly. Smoothed; LFO destinations 8 and 9 modulate it.
+void synth_set_position1(Synth* s, float pos);
+void synth_set_position2(Synth* s, float pos);
+
+// Stereo placement for synth_render_planar: master pan (-1 left .. 1 right)
+// and voice spread (0..1). With spread, each new note takes its own position
+// around the pan, spreading chords and unison stacks across the field.
+// Changes glide over one block.
+void synth_set_pan(Synth* s, float pan);
+void synth_set_spread(Synth* s, float spread);
+
+// Unison: the oscillator (1 or 2) plays 'voices' (1..16, 1 = off) detuned
+// copies of its wavetable, shared by the note's filter and envelopes. Copies
+// spread over +-detune semitones (0..12), evenly at curve 0, gathered near
+// the centre towards curve 1; width (0..1) fans them across the stereo field
+// of synth_render_planar. The stack is scaled by 1/sqrt(voices). FM (wave 4)
+// always plays a single copy.
+void synth_unison(Synth* s, int osc, int voices, float detune, float curve, float width);
+// Start phases of the copies at note-on: 0 = the same fixed offsets every
+// note (a repeatable attack), 1 = fully random
+void synth_unison_phase(Synth* s, int osc, float random);
+
+// FM controls. Wave 4 is a four-operator phase-modulation voice per oscillator
+// (osc = 1 or 2, operators 1..4). synth_fm1/2 set the ratios of operators 1
+// (car) and 2 (mod) and the modulation index, which scales every modulator
+// and is smoothed (LFO destinations 6 and 7). The default patch is that
+// two-operator pair: algorithm 0, operators 3 and 4 at level 0.
+void synth_fm1(Synth* s, float car, float mod, float index);
+void synth_fm2(Synth* s, float car, float mod, float index);
+// Algorithm 0..7 (a > b: a modulates b, + sums carriers):
+//   0: 4 > 3 > 2 > 1          4: 2 > 1 + 4 > 3
+//   1: (3 + 4) > 2 > 1        5: 4 > 1, 4 > 2, 4 > 3
+//   2: (4 + 3 > 2) > 1        6: 4 > 3 + 1 + 2
+//   3: (4 > 3 + 2) > 1        7: 1 + 2 + 3 + 4
+void synth_fm_algorithm(Synth* s, int osc, int algorithm);
+// Self-modulation of operator 4, 0..1
+void synth_fm_feedback(Synth* s, int osc, float amount);
+// Frequency ratio to the note and level of one operator: output gain for a
+// carrier, peak phase deviation in radians (times the index) for a modulator.
+// Operators at level 0 cost nothing.
+void synth_fm_op(Synth* s, int osc, int op, float ratio, float level);
+// Operator envelope (ADSR as synth_set_env) scaling its level; attack < 0
+// turns it off, so the level holds (the default)
+void synth_fm_op_env(Synth* s, int osc, int op, float attack, float decay, float sustain, float release);
+
+// Release the engine's DSP resources (the handle stays valid for synth_init)
+void synth_shutdown(Synth* s);
 }
@@ -0,0 +1,87 @@
+#include "worker_pool.h"
+
+namespace {
+    constexpr int SPIN_LIMIT = 1 << 14; // idle polls before a worker sleeps
+
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+WorkerPool& WorkerPool::instance() {
+    static WorkerPool pool;
+    return pool;
+}
+
+WorkerPool::~WorkerPool() {
+    quit_.store(true);
+    {
+        std::lock_guard<std::mutex> lk(sleep_lock_);
+        wake_.notify_all();
+    }
+    for (std::thread& t : threads_) t.join();
+}
+
+void WorkerPool::reserve(int n) {
+#ifndef SYNTH_NO_THREADS
+    std::lock_guard<std::mutex> rl(reserve_lock_);
+    // Spinning workers on an oversubscribed machine only slow the caller down
+    int hw = static_cast<int>(std::thread::hardware_concurrency());
+    if (hw > 0 && n > hw) n = hw;
+    if (n <= size()) return;
+    // No job is in flight while the set of workers changes
+    std::lock_guard<std::mutex> lk(run_lock_);
+    unsigned gen = generation_.load();
+    while (size() < n) {
+        int index = size();
+        threads_.emplace_back([this, index, gen] {
+            unsigned seen = gen;
+            for (;;) {
+                unsigned g;
+                int spins = 0;
+                while ((g = generation_.load()) == seen && !quit_.load()) {
+                    if (++spins < SPIN_LIMIT) { cpu_relax(); continue; }
+                    std::unique_lock<std::mutex> sl(sleep_lock_);
+                    sleepers_.fetch_add(1);
+                    wake_.wait(sl, [&] { return generation_.load() != seen || quit_.load(); });
+                    sleepers_.fetch_sub(1);
+                }
+                if (quit_.load()) return;
+                seen = g;
+                if (index < n_) fn_(ctx_, index);
+                pending_.fetch_sub(1, std::memory_order_release);
+            }
+        });
+    }
+#else
+    (void)n;
+#endif
+}
+
+void WorkerPool::run(int n, JobFn fn, void* ctx) {
+    std::unique_lock<std::mutex> lk(run_lock_, std::try_to_lock);
+    if (n <= 1 || !lk.owns_lock() || threads_.empty()) {
+        fn(ctx, 0);
+        return;
+    }
+    fn_ = fn;
+    ctx_ = ctx;
+    n_ = n;
+    // Every worker acknowledges every job, so none can still be reading this
+    // one when the next is published
+    pending_.store(static_cast<int>(threads_.size()));
+    generation_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> sl(sleep_lock_);
+        wake_.notify_all();
+    }
+    fn(ctx, 0);
+    for (int spins = 0; pending_.load(std::memory_order_acquire) > 0; ++spins) {
+        if (spins < SPIN_LIMIT) cpu_relax();
+        else std::this_thread::yield();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define SYNTH_NO_THREADS 1 // WASM built without -pthread: no std::thread
+#endif
+
+// Persistent worker threads shared by every engine in the process. run() calls
+// fn(ctx, k) for k = 0..n-1, k = 0 on the calling thread, and returns once all
+// have finished. Workers spin briefly between jobs (render blocks arrive every
+// millisecond or so) before sleeping, so a dispatch normally costs no syscall.
+//
+// Jobs must not depend on how many workers actually run: when the pool is busy
+// with another caller, or has no threads (WASM without pthreads), run() falls
+// back to fn(ctx, 0) alone, so work is handed out from a shared counter rather
+// than by worker index.
+class WorkerPool {
+public:
+    using JobFn = void (*)(void* ctx, int worker);
+
+    static WorkerPool& instance();
+
+    // Start threads so that up to n workers (including the caller) can run,
+    // capped at the hardware thread count. Spawns threads, so call it from
+    // setup code, not the audio callback.
+    void reserve(int n);
+    // Workers available to run(), including the calling thread
+    int size() const { return static_cast<int>(threads_.size()) + 1; }
+
+    void run(int n, JobFn fn, void* ctx);
+
+    ~WorkerPool();
+
+private:
+    WorkerPool() = default;
+
+    std::vector<std::thread> threads_;
+    std::mutex reserve_lock_;
+    std::mutex run_lock_;      // one dispatch at a time; others run inline
+
+    // Current job, published by bumping generation_
+    JobFn fn_ = nullptr;
+    void* ctx_ = nullptr;
+    int n_ = 0;
+    std::atomic<unsigned> generation_{0};
+    std::atomic<int> pending_{0};
+    std::atomic<bool> quit_{false};
+
+    std::mutex sleep_lock_;
+    std::condition_variable wake_;
+    std::atomic<int> sleepers_{0};
+};
@@ -0,0 +1,617 @@
+// Golden-output regression test: renders a corpus of canonical patches and
+// note sequences and compares each render against stored reference features,
+// and records the render time of every case.
+//
+//   wavetable_golden_test --ref tests/golden/reference.txt [--update] [--only NAME]
+//                         [--threads N] [--timing out.csv] [--wav-dir DIR]
+//
+// The references are not samples but per-window levels: the RMS and the energy
+// in half-octave bands of each eighth of the render, in dB. Cases pass within
+// RMS_TOL_DB / BAND_TOL_DB, so numeric changes that leave the sound alone (SIMD
+// width, operation order, faster approximations) keep passing, while a changed
+// envelope, filter, tuning or modulation fails. --update rewrites the
+// references after an intended change of sound; review the diff like code.
+// --threads renders on the worker pool (the output must not depend on it),
+// --timing writes ns/sample per case as CSV and --wav-dir saves every render.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wavetable_bank.h"
+#include "wavetable_synth.h"
+#include "wav_writer.h"
+
+// Every operator new in the process is counted, so check_no_allocation can
+// tell whether the engine touched the heap
+static std::atomic<long> g_allocations{0};
+
+void* operator new(std::size_t n) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+    constexpr int SR = 48000;
+    constexpr int BLOCK = 128;
+    constexpr int FRAMES = SR;          // one second per case
+    constexpr int WINDOWS = 8;
+    constexpr int WINDOW = FRAMES / WINDOWS;
+    constexpr int FFT_SIZE = 4096;
+    constexpr int BANDS = 16;           // half octaves from 62.5 Hz
+    constexpr double BAND_LO_HZ = 62.5;
+    constexpr double FLOOR_DB = -100.0;
+    constexpr double RMS_TOL_DB = 1.0;
+    constexpr double BAND_TOL_DB = 3.0;
+    constexpr double BAND_RANGE_DB = 50.0; // bands this far below a window's loudest are not compared
+    constexpr double QUIET_DB = -70.0;     // windows quieter than this only have to stay quiet
+
+    struct Event {
+        double sec;
+        int type, i;
+        float a;
+    };
+
+    struct Case {
+        const char* name;
+        std::function<void(Synth*)> setup;
+        int channels = 1;
+        std::vector<Event> events = {}; // played along with the phrase
+        std::function<void(Synth*, int)> on_block = nullptr; // called before rendering each block at this frame
+    };
+
+    struct Features {
+        int channels = 0;
+        // [channel][window]: rms, then the bands
+        std::vector<std::vector<std::array<double, BANDS + 1>>> win;
+    };
+
+    // Every case plays this phrase, queued as timestamped events: a held chord
+    // and a staccato arpeggio over it, released well before the end so the
+    // release tails are covered too. The queue is FIFO, so the case's own
+    // events are merged in by time.
+    void post_phrase(Synth* s, const std::vector<Event>& extra) {
+        std::vector<Event> ev;
+        const int chord[] = {48, 55, 60, 64};
+        for (int n : chord) ev.push_back({0.0, SYNTH_EV_NOTE_ON, n, 0.8f});
+        for (int n : chord) ev.push_back({0.6, SYNTH_EV_NOTE_OFF, n, 0.0f});
+        const int arp[] = {72, 76, 79, 84, 79, 76};
+        for (int k = 0; k < 6; ++k) {
+            ev.push_back({0.1 + 0.08 * k, SYNTH_EV_NOTE_ON, arp[k], 0.6f});
+            ev.push_back({0.16 + 0.08 * k, SYNTH_EV_NOTE_OFF, arp[k], 0.0f});
+        }
+        ev.insert(ev.end(), extra.begin(), extra.end());
+        std::stable_sort(ev.begin(), ev.end(), [](const Event& x, const Event& y) { return x.sec < y.sec; });
+        for (const Event& e : ev) synth_post_event(s, (uint32_t)(e.sec * SR), e.type, e.i, e.a, 0, 0, 0);
+    }
+
+    // Common starting point: both oscillators on the case's wave, a little
+    // detune, the filter open enough to hear it
+    void base_patch(Synth* s, int wave) {
+        synth_set_poly(s, 16);
+        synth_set_wave1(s, wave);
+        synth_set_wave2(s, wave);
+        synth_set_detune2(s, 0.07f);
+        synth_filter_set(s, 2500.0f, 0.3f);
+        synth_set_env(s, 0.005f, 0.1f, 0.7f, 0.15f);
+    }
+
+    // Two-frame user table (sine, then a 7-partial saw), kept alive for the
+    // process; waits until its mip levels are built so renders are repeatable
+    std::vector<float> g_user_frames;
+    int user_table(Synth* s) {
+        constexpr int size = 1024;
+        if (g_user_frames.empty()) {
+            g_user_frames.resize(2 * size);
+            for (int i = 0; i < size; ++i) {
+                double ph = 2.0 * M_PI * i / size, saw = 0.0;
+                for (int k = 1; k <= 7; ++k) saw += std::sin(ph * k) / k;
+                g_user_frames[i] = (float)std::sin(ph);
+                g_user_frames[size + i] = (float)(0.6 * saw);
+            }
+        }
+        int wave = synth_wavetable_create(s, g_user_frames.data(), 2, size);
+        while (wave >= 0 && !synth_wavetable_ready(s, wave)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return wave;
+    }
+
+    void fm_four_op(Synth* s, int osc) {
+        synth_fm_algorithm(s, osc, 1);
+        synth_fm_feedback(s, osc, 0.4f);
+        synth_fm_op(s, osc, 2, 2.0f, 1.2f);
+        synth_fm_op(s, osc, 3, 3.0f, 0.8f);
+        synth_fm_op(s, osc, 4, 0.5f, 1.0f);
+        synth_fm_op_env(s, osc, 2, 0.01f, 0.3f, 0.2f, 0.2f);
+        synth_fm_op_env(s, osc, 4, 0.0f, 0.5f, 0.0f, 0.1f);
+    }
+
+    // Snapshot of a patch built with the setters on a scratch engine
+    std::vector<uint8_t> snapshot(const std::function<void(Synth*)>& setup) {
+        Synth* tmp = synth_create(SR, 2048);
+        setup(tmp);
+        std::vector<uint8_t> blob(synth_get_state(tmp, nullptr, 0));
+        synth_get_state(tmp, blob.data(), (int)blob.size());
+        synth_destroy(tmp);
+        return blob;
+    }
+
+    void fm_lead(Synth* s) {
+        base_patch(s, 4);
+        fm_four_op(s, 1);
+        synth_set_wave2(s, 1);
+        synth_set_detune2(s, -12.0f);
+        synth_filter_mode(s, 3);
+        synth_filter_env(s, 0.02f, 0.2f, 0.3f, 0.2f);
+        synth_lfo_set(s, 4.0f);
+        synth_lfo_dest(s, 6);
+        synth_lfo_amount(s, 1.5f);
+        synth_set_spread(s, 0.5f);
+    }
+
+    // Supersaw-style stacks on a saw and on the user table, fanned out in stereo
+    void unison_wide(Synth* s) {
+        base_patch(s, 1);
+        synth_set_wave2(s, user_table(s));
+        synth_set_position2(s, 0.7f);
+        synth_unison(s, 1, 7, 0.25f, 0.5f, 1.0f);
+        synth_unison(s, 2, 4, 0.1f, 0.0f, 0.6f);
+        synth_unison_phase(s, 1, 1.0f);
+    }
+
+    // Every kind of modulation source on one patch: two extra LFOs, the
+    // envelopes, velocity and key tracking
+    void mod_matrix(Synth* s) {
+        base_patch(s, 1);
+        synth_mod_lfo(s, 2, 3.0f, SYNTH_LFO_TRIANGLE);
+        synth_mod_lfo(s, 3, 7.0f, SYNTH_LFO_SQUARE);
+        synth_mod_route(s, 0, SYNTH_MOD_LFO2, SYNTH_MOD_CUTOFF, 800.0f);
+        synth_mod_route(s, 1, SYNTH_MOD_LFO3, SYNTH_MOD_GAIN2, 0.3f);
+        synth_mod_route(s, 2, SYNTH_MOD_KEY, SYNTH_MOD_CUTOFF, 600.0f);
+        synth_mod_route(s, 3, SYNTH_MOD_VELOCITY, SYNTH_MOD_AMP, 0.3f);
+        synth_mod_route(s, 4, SYNTH_MOD_FILTER_ENV, SYNTH_MOD_PITCH, 0.5f);
+        synth_mod_route(s, 5, SYNTH_MOD_AMP_ENV, SYNTH_MOD_GAIN1, -0.3f);
+    }
+
+    // Saving a patch, loading it into a fresh engine and saving again must give
+    // the same bytes; truncated or foreign blobs must be refused, and a patch
+    // of the first version (without unison) still loads
+    std::vector<std::string> check_state_round_trip() {
+        std::vector<std::string> errs;
+        std::vector<uint8_t> wide = snapshot([](Synth* s) { unison_wide(s); mod_matrix(s); });
+        Synth* w = synth_create(SR, 2048);
+        if (!synth_load_state(w, wide.data(), (int)wide.size())) errs.push_back("unison snapshot refused");
+        float block[BLOCK];
+        synth_render(w, block, BLOCK);
+        std::vector<uint8_t> again(wide.size());
+        synth_get_state(w, again.data(), (int)again.size());
+        if (again != wide) errs.push_back("reloaded unison patch saves differently");
+        synth_destroy(w);
+
+        std::vector<uint8_t> a = snapshot(fm_lead);
+        // Versions 2 and 3 appended 10 and 5 + 3 * SYNTH_MOD_ROUTES fields
+        std::vector<uint8_t> v1(a.begin(), a.end() - 4 * (15 + 3 * SYNTH_MOD_ROUTES));
+        v1[4] = 1;
+        v1[8] = (uint8_t)v1.size();
+        v1[9] = (uint8_t)(v1.size() >> 8);
+        Synth* s = synth_create(SR, 2048);
+        float out[BLOCK];
+        if (!synth_load_state(s, a.data(), (int)a.size())) errs.push_back("snapshot refused");
+        if (synth_load_state(s, a.data(), (int)a.size() - 4)) errs.push_back("truncated snapshot accepted");
+        std::vector<uint8_t> junk(a.size(), 0x5a);
+        if (synth_load_state(s, junk.data(), (int)junk.size())) errs.push_back("foreign blob accepted");
+        if (!synth_load_state(s, v1.data(), (int)v1.size())) errs.push_back("version 1 snapshot refused");
+        synth_render(s, out, BLOCK);
+        std::vector<uint8_t> b(a.size());
+        if (synth_get_state(s, b.data(), (int)b.size() - 1) != 0) errs.push_back("short buffer written");
+        if (synth_get_state(s, b.data(), (int)b.size()) != (int)a.size() || a != b) errs.push_back("reloaded patch saves differently");
+        synth_destroy(s);
+        return errs;
+    }
+
+    // Once created, an engine plays notes, changes polyphony, loads patches
+    // and renders (on the worker pool too) without allocating: all of its
+    // state comes from the arena synth_create sized up front
+    std::vector<std::string> check_no_allocation(int threads) {
+        std::vector<std::string> errs;
+        std::vector<uint8_t> patch = snapshot([](Synth* s) { unison_wide(s); mod_matrix(s); });
+        Synth* s = synth_create(SR, 2048);
+        synth_set_threads(s, threads, 2); // starts the pool threads: setup, not counted
+        if (synth_memory_bytes(s) <= 0) errs.push_back("no memory footprint reported");
+        float out[2 * BLOCK];
+        long before = g_allocations.load();
+        synth_set_poly(s, 4);
+        for (int k = 0; k < 6; ++k) synth_note_on(s, 48 + 3 * k, 0.8f);
+        synth_render(s, out, BLOCK);
+        synth_set_poly(s, 64);
+        synth_set_threads(s, threads, 2);
+        for (int k = 0; k < 24; ++k) synth_note_on(s, 36 + 2 * k, 0.7f);
+        synth_load_state(s, patch.data(), (int)patch.size());
+        for (int b = 0; b < 8; ++b) synth_render_planar(s, out, BLOCK, 2, BLOCK, nullptr, 0, 0);
+        synth_set_poly(s, 8);
+        synth_render_planar(s, out, BLOCK, 2, BLOCK, nullptr, 0, 0);
+        long n = g_allocations.load() - before;
+        if (n) errs.push_back(std::to_string(n) + " allocations after synth_create");
+        synth_destroy(s);
+        return errs;
+    }
+
+    // A replaced user table stays in use until the oscillator has crossfaded
+    // away from it, so the host must not release it before
+    std::vector<std::string> check_table_swap() {
+        std::vector<std::string> errs;
+        Synth* s = synth_create(SR, 2048);
+        int a = user_table(s), b = user_table(s);
+        float out[BLOCK];
+        synth_set_wave1(s, a);
+        synth_note_on(s, 60, 0.8f);
+        synth_render(s, out, BLOCK);
+        synth_set_wave1(s, b);
+        synth_render(s, out, BLOCK); // the default 5 ms fade outlasts one block
+        if (!synth_wavetable_in_use(s, a)) errs.push_back("old table unused during the crossfade");
+        for (int k = 0; k < 4; ++k) synth_render(s, out, BLOCK);
+        if (synth_wavetable_in_use(s, a)) errs.push_back("old table still in use after the crossfade");
+        if (!synth_wavetable_in_use(s, b)) errs.push_back("new table not in use");
+        synth_destroy(s);
+        return errs;
+    }
+
+    // LFO case: a destination with a patch where it is clearly audible
+    Case lfo_case(const char* name, int dest, float amount) {
+        return {name, [dest, amount](Synth* s) {
+            int wave = dest == 6 || dest == 7 ? 4 : 1;
+            base_patch(s, wave);
+            if (dest == 8 || dest == 9) {
+                int w = user_table(s);
+                synth_set_wave1(s, w);
+                synth_set_wave2(s, w);
+            }
+            synth_lfo_set(s, 6.0f);
+            synth_lfo_dest(s, dest);
+            synth_lfo_amount(s, amount);
+        }};
+    }
+
+    std::vector<Case> build_cases() {
+        std::vector<Case> c;
+        c.push_back({"sine", [](Synth* s) { base_patch(s, 0); }});
+        c.push_back({"saw", [](Synth* s) { base_patch(s, 1); }});
+        c.push_back({"square", [](Synth* s) { base_patch(s, 2); }});
+        c.push_back({"triangle", [](Synth* s) { base_patch(s, 3); }});
+        c.push_back({"saw_unfiltered", [](Synth* s) { base_patch(s, 1); synth_filter_enable(s, 0); }});
+        c.push_back({"user_table", [](Synth* s) {
+            base_patch(s, 1);
+            int w = user_table(s);
+            synth_set_wave1(s, w);
+            synth_set_position1(s, 0.5f);
+        }});
+        c.push_back({"fm_pair", [](Synth* s) { base_patch(s, 4); synth_fm1(s, 1.0f, 2.0f, 3.0f); synth_fm2(s, 2.0f, 1.0f, 1.5f); }});
+        c.push_back({"fm_four_op", [](Synth* s) { base_patch(s, 4); fm_four_op(s, 1); fm_four_op(s, 2); }});
+        c.push_back({"fm_parallel", [](Synth* s) {
+            base_patch(s, 4);
+            synth_fm_algorithm(s, 1, 5);
+            synth_fm_op(s, 1, 3, 4.0f, 0.5f);
+            synth_fm_op(s, 1, 4, 1.0f, 1.5f);
+            synth_set_gain2(s, 0.0f);
+        }});
+        for (int mode = 0; mode < 4; ++mode) {
+            static const char* names[] = {"filter_env_ladder", "filter_env_zdf", "filter_env_zdf2x", "filter_env_svf"};
+            c.push_back({names[mode], [mode](Synth* s) {
+                base_patch(s, 1);
+                synth_filter_mode(s, mode);
+                synth_filter_set(s, 400.0f, 0.7f);
+                synth_filter_env(s, 0.01f, 0.25f, 0.2f, 0.2f);
+                synth_filter_env_amount(s, 4000.0f);
+            }});
+        }
+        c.push_back(lfo_case("lfo_pitch", 0, 0.5f));
+        c.push_back(lfo_case("lfo_cutoff", 1, 1500.0f));
+        c.push_back(lfo_case("lfo_amp", 2, 0.3f));
+        c.push_back(lfo_case("lfo_res", 3, 0.5f));
+        c.push_back(lfo_case("lfo_gain1", 4, 0.5f));
+        c.push_back(lfo_case("lfo_gain2", 5, 0.5f));
+        c.push_back(lfo_case("lfo_fm1_index", 6, 2.0f));
+        c.push_back(lfo_case("lfo_fm2_index", 7, 2.0f));
+        c.push_back(lfo_case("lfo_position1", 8, 0.5f));
+        c.push_back(lfo_case("lfo_position2", 9, 0.5f));
+        c.push_back({"voice_steal", [](Synth* s) { base_patch(s, 2); synth_set_poly(s, 3); }});
+        c.push_back({"wave_switch", [](Synth* s) {
+            base_patch(s, 0);
+            synth_set_wave_crossfade(s, 20.0f);
+        }, 1, {{0.3, SYNTH_EV_WAVE1, 1, 0.0f}, {0.45, SYNTH_EV_WAVE2, 3, 0.0f}}});
+        // The same patch as snapshot, and a switch to it while notes are held
+        std::vector<uint8_t> lead = snapshot(fm_lead);
+        c.push_back({"fm_lead", fm_lead});
+        c.push_back({"state_load", [lead](Synth* s) { synth_load_state(s, lead.data(), (int)lead.size()); }});
+        c.push_back({"state_switch", [](Synth* s) { base_patch(s, 2); }, 1, {}, [lead](Synth* s, int pos) {
+            if (pos == (int)(0.3 * SR) / BLOCK * BLOCK) synth_load_state(s, lead.data(), (int)lead.size());
+        }});
+        c.push_back({"slow_envelope", [](Synth* s) { base_patch(s, 3); synth_set_env(s, 0.3f, 0.2f, 0.5f, 0.3f); }});
+        c.push_back({"stereo_spread", [](Synth* s) {
+            base_patch(s, 1);
+            synth_set_pan(s, 0.3f);
+            synth_set_spread(s, 1.0f);
+        }, 2});
+        c.push_back({"unison_supersaw", [](Synth* s) {
+            base_patch(s, 1);
+            synth_unison(s, 1, 9, 0.35f, 0.6f, 0.0f);
+            synth_set_gain2(s, 0.0f);
+        }});
+        c.push_back({"unison_wide", unison_wide, 2});
+        c.push_back({"mod_matrix", mod_matrix});
+        c.push_back({"mod_wheel", [](Synth* s) {
+            base_patch(s, 1);
+            synth_mod_route(s, 0, SYNTH_MOD_WHEEL, SYNTH_MOD_CUTOFF, 3000.0f);
+            synth_mod_route(s, 1, SYNTH_MOD_WHEEL, SYNTH_MOD_POSITION1, 1.0f);
+            synth_set_wave1(s, user_table(s));
+        }, 1, {{0.3, SYNTH_EV_MOD_WHEEL, 0, 1.0f}, {0.6, SYNTH_EV_MOD_WHEEL, 0, 0.2f}}});
+        for (int q = 1; q <= 4; ++q) {
+            static const char* names[] = {"", "quality_1", "quality_2", "quality_3", "quality_4"};
+            c.push_back({names[q], [q](Synth* s) {
+                base_patch(s, 1);
+                synth_lfo_dest(s, 1);
+                synth_lfo_amount(s, 1000.0f);
+                synth_set_quality(s, q);
+            }});
+        }
+        return c;
+    }
+
+    // Level of each window and its half-octave band energies (Hann-windowed
+    // FFT at the window centre), in dB
+    std::array<double, BANDS + 1> analyse(const float* x) {
+        std::array<double, BANDS + 1> f;
+        double sum = 0.0;
+        for (int i = 0; i < WINDOW; ++i) sum += (double)x[i] * x[i];
+        f[0] = std::max(FLOOR_DB, 10.0 * std::log10(sum / WINDOW + 1e-30));
+
+        std::vector<double> re(FFT_SIZE), im(FFT_SIZE, 0.0);
+        int start = (WINDOW - FFT_SIZE) / 2;
+        for (int i = 0; i < FFT_SIZE; ++i) {
+            double w = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / FFT_SIZE);
+            re[i] = x[start + i] * w;
+        }
+        fft_complex(re.data(), im.data(), FFT_SIZE, false);
+        double power[BANDS] = {};
+        for (int k = 1; k < FFT_SIZE / 2; ++k) {
+            double hz = (double)k * SR / FFT_SIZE;
+            int b = (int)std::floor(2.0 * std::log2(hz / BAND_LO_HZ));
+            if (b < 0 || b >= BANDS) continue;
+            power[b] += re[k] * re[k] + im[k] * im[k];
+        }
+        // Scaled so a full-scale sine reads about 0 dB in its band
+        double norm = 4.0 / ((double)FFT_SIZE * FFT_SIZE * 0.375);
+        for (int b = 0; b < BANDS; ++b) f[1 + b] = std::max(FLOOR_DB, 10.0 * std::log10(power[b] * norm + 1e-30));
+        return f;
+    }
+
+    struct Run {
+        Features features;
+        double ns_per_sample = 0.0;
+        bool finite = true;
+    };
+
+    Run render_case(const Case& c, int threads, const std::string& wav_dir) {
+        Synth* s = synth_create(SR, 2048);
+        synth_set_threads(s, threads, 1);
+        c.setup(s);
+        post_phrase(s, c.events);
+        std::vector<float> out((std::size_t)FRAMES * c.channels);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int pos = 0; pos < FRAMES; pos += BLOCK) {
+            if (c.on_block) c.on_block(s, pos);
+            if (c.channels == 1) synth_render(s, out.data() + pos, BLOCK);
+            else synth_render_planar(s, out.data() + pos, FRAMES, c.channels, BLOCK, nullptr, 0, 0);
+        }
+        double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        synth_destroy(s);
+
+        Run r;
+        r.ns_per_sample = dt * 1e9 / FRAMES;
+        for (float v : out) r.finite &= std::isfinite(v);
+        r.features.channels = c.channels;
+        r.features.win.resize(c.channels);
+        for (int ch = 0; ch < c.channels; ++ch) {
+            for (int w = 0; w < WINDOWS; ++w) {
+                r.features.win[ch].push_back(analyse(out.data() + (std::size_t)ch * FRAMES + w * WINDOW));
+            }
+        }
+        if (!wav_dir.empty()) {
+            WavWriter wav;
+            std::string path = wav_dir + "/" + c.name + ".wav";
+            if (wav.open(path.c_str(), SR, c.channels)) {
+                std::vector<float> frame(c.channels);
+                for (int i = 0; i < FRAMES; ++i) {
+                    for (int ch = 0; ch < c.channels; ++ch) frame[ch] = out[(std::size_t)ch * FRAMES + i];
+                    wav.write(frame.data(), 1);
+                }
+            }
+        }
+        return r;
+    }
+
+    // Reference file: "case channel window rms band..." lines, '#' comments
+    bool read_refs(const char* path, std::map<std::string, Features>& refs) {
+        std::FILE* f = std::fopen(path, "r");
+        if (!f) return false;
+        char line[1024];
+        while (std::fgets(line, sizeof(line), f)) {
+            if (line[0] == '#' || line[0] == '\n') continue;
+            char name[64];
+            int ch, w, used;
+            if (std::sscanf(line, "%63s %d %d%n", name, &ch, &w, &used) != 3 || ch < 0 || ch > 1 || w < 0 || w >= WINDOWS) continue;
+            Features& ft = refs[name];
+            if (ft.channels <= ch) {
+                ft.channels = ch + 1;
+                ft.win.resize(ch + 1, std::vector<std::array<double, BANDS + 1>>(WINDOWS));
+            }
+            const char* p = line + used;
+            for (double& v : ft.win[ch][w]) {
+                char* end = nullptr;
+                v = std::strtod(p, &end);
+                p = end;
+            }
+        }
+        std::fclose(f);
+        return true;
+    }
+
+    bool write_refs(const char* path, const std::vector<Case>& cases, const std::vector<Run>& runs) {
+        std::FILE* f = std::fopen(path, "w");
+        if (!f) return false;
+        std::fprintf(f, "# wavetable_golden_test references (--update rewrites this file)\n");
+        std::fprintf(f, "# case channel window rms_db band_db[%d] (half octaves from %.1f Hz)\n", BANDS, BAND_LO_HZ);
+        for (std::size_t i = 0; i < cases.size(); ++i) {
+            const Features& ft = runs[i].features;
+            for (int ch = 0; ch < ft.channels; ++ch) {
+                for (int w = 0; w < WINDOWS; ++w) {
+                    std::fprintf(f, "%s %d %d", cases[i].name, ch, w);
+                    for (double v : ft.win[ch][w]) std::fprintf(f, " %.2f", v);
+                    std::fprintf(f, "\n");
+                }
+            }
+        }
+        std::fclose(f);
+        return true;
+    }
+
+    // Mismatches between a render and its reference, one message each
+    std::vector<std::string> compare(const Features& got, const Features& ref) {
+        std::vector<std::string> errs;
+        if (got.channels != ref.channels) {
+            errs.push_back("channel count differs from the reference");
+            return errs;
+        }
+        char msg[160];
+        for (int ch = 0; ch < ref.channels; ++ch) {
+            for (int w = 0; w < WINDOWS; ++w) {
+                const auto& g = got.win[ch][w];
+                const auto& r = ref.win[ch][w];
+                if (r[0] < QUIET_DB) {
+                    if (g[0] > QUIET_DB + RMS_TOL_DB) {
+                        std::snprintf(msg, sizeof(msg), "ch %d window %d: %.2f dB where the reference is silent", ch, w, g[0]);
+                        errs.push_back(msg);
+                    }
+                    continue;
+                }
+                if (std::fabs(g[0] - r[0]) > RMS_TOL_DB) {
+                    std::snprintf(msg, sizeof(msg), "ch %d window %d: rms %.2f dB, reference %.2f dB", ch, w, g[0], r[0]);
+                    errs.push_back(msg);
+                }
+                double loudest = *std::max_element(r.begin() + 1, r.end());
+                for (int b = 0; b < BANDS; ++b) {
+                    if (r[1 + b] < loudest - BAND_RANGE_DB) continue;
+                    if (std::fabs(g[1 + b] - r[1 + b]) > BAND_TOL_DB) {
+                        std::snprintf(msg, sizeof(msg), "ch %d window %d: band %.0f Hz %.2f dB, reference %.2f dB",
+                                      ch, w, BAND_LO_HZ * std::pow(2.0, b * 0.5), g[1 + b], r[1 + b]);
+                        errs.push_back(msg);
+                    }
+                }
+            }
+        }
+        return errs;
+    }
+
+    void usage() {
+        std::fprintf(stderr,
+            "usage: wavetable_golden_test --ref FILE [--update] [--only NAME] [--threads N]\n"
+            "                             [--timing out.csv] [--wav-dir DIR]\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* ref_path = nullptr;
+    const char* timing_path = nullptr;
+    std::string only, wav_dir;
+    bool update = false;
+    int threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--update") update = true;
+        else if (a == "--ref" && v) { ref_path = v; ++i; }
+        else if (a == "--only" && v) { only = v; ++i; }
+        else if (a == "--threads" && v) { threads = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--timing" && v) { timing_path = v; ++i; }
+        else if (a == "--wav-dir" && v) { wav_dir = v; ++i; }
+        else { usage(); return 2; }
+    }
+    if (!ref_path) { usage(); return 2; }
+
+    std::vector<Case> cases;
+    for (Case& c : build_cases()) if (only.empty() || only == c.name) cases.push_back(c);
+    std::map<std::string, Features> refs;
+    if (!update && !read_refs(ref_path, refs)) {
+        std::fprintf(stderr, "%s: cannot read references\n", ref_path);
+        return 1;
+    }
+
+    std::vector<Run> runs;
+    int failed = 0;
+    if (only.empty()) {
+        std::vector<std::string> errs = check_state_round_trip();
+        std::printf("%-4s %-20s\n", errs.empty() ? "ok" : "FAIL", "state_round_trip");
+        for (const std::string& e : errs) std::printf("       %s\n", e.c_str());
+        failed += errs.empty() ? 0 : 1;
+        errs = check_no_allocation(threads);
+        std::printf("%-4s %-20s\n", errs.empty() ? "ok" : "FAIL", "no_allocation");
+        for (const std::string& e : errs) std::printf("       %s\n", e.c_str());
+        failed += errs.empty() ? 0 : 1;
+        errs = check_table_swap();
+        std::printf("%-4s %-20s\n", errs.empty() ? "ok" : "FAIL", "table_swap");
+        for (const std::string& e : errs) std::printf("       %s\n", e.c_str());
+        failed += errs.empty() ? 0 : 1;
+    }
+    for (const Case& c : cases) {
+        runs.push_back(render_case(c, threads, wav_dir));
+        const Run& r = runs.back();
+        std::vector<std::string> errs;
+        if (!r.finite) errs.push_back("output is not finite");
+        if (!update) {
+            auto it = refs.find(c.name);
+            if (it == refs.end()) errs.push_back("no reference (run with --update)");
+            else for (std::string& e : compare(r.features, it->second)) errs.push_back(e);
+        }
+        std::printf("%-4s %-20s %8.1f ns/sample\n", errs.empty() ? "ok" : "FAIL", c.name, r.ns_per_sample);
+        for (std::size_t k = 0; k < errs.size() && k < 8; ++k) std::printf("       %s\n", errs[k].c_str());
+        if (errs.size() > 8) std::printf("       ... %zu more\n", errs.size() - 8);
+        failed += errs.empty() ? 0 : 1;
+    }
+
+    if (timing_path) {
+        if (std::FILE* f = std::fopen(timing_path, "w")) {
+            std::fprintf(f, "case,ns_per_sample,realtime_factor\n");
+            for (std::size_t i = 0; i < cases.size(); ++i) {
+                std::fprintf(f, "%s,%.2f,%.2f\n", cases[i].name, runs[i].ns_per_sample, 1e9 / SR / runs[i].ns_per_sample);
+            }
+            std::fclose(f);
+        }
+    }
+    if (update) {
+        if (!only.empty()) {
+            std::fprintf(stderr, "--update rewrites every case; drop --only\n");
+            return 2;
+        }
+        if (!write_refs(ref_path, cases, runs)) {
+            std::fprintf(stderr, "%s: cannot write\n", ref_path);
+            return 1;
+        }
+        std::printf("wrote %zu cases to %s\n", cases.size(), ref_path);
+        return failed ? 1 : 0;
+    }
+    std::printf("%zu cases, %d failed\n", cases.size(), failed);
+    return failed ? 1 : 0;
+}
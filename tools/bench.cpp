@@ -0,0 +1,247 @@
+// DSP benchmark: renders held chords through the engine and reports the cost
+// per output sample and the realtime factor for each case, as JSON (default)
+// or CSV, so results can be diffed between commits.
+//
+//   wavetable_bench [--full] [--csv] [--seconds S] [--repeat N] [--sr N] [--block N]
+//                   [--threads N] [--min-voices N] [--quality L] [--filter-mode M] [--fm-ops N]
+//                   [--unison N] [--mod N]
+//
+// The default sweep varies one axis at a time around 8 saw voices with the filter
+// on (voice count, wave type, filter on/off, LFO destination); --full runs the
+// whole cross product. --threads renders voices on the worker pool
+// (synth_set_threads) with --min-voices voices per thread. --quality pins a
+// CPU governor level (synth_set_quality) to measure what each level saves;
+// --filter-mode selects the filter (synth_filter_mode) for the filtered cases.
+// --fm-ops 4 gives the FM cases a four-operator patch (feedback and operator
+// envelopes) instead of the default two-operator pair. --unison stacks N
+// detuned copies on both oscillators (synth_unison), to compare a stack with
+// the same number of full voices. --mod installs N modulation matrix routes
+// (synth_mod_route), alternating global LFO routes with per-voice envelope,
+// velocity and key routes. The JSON also reports
+// state_load_ns, the cost of switching patches with synth_load_state while
+// notes are held (decode plus applying it in the next block), and
+// memory_bytes, an engine's footprint (synth_memory_bytes).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simd.h"
+#include "voice_dsp.h"
+#include "wavetable_synth.h"
+
+namespace {
+    struct Case {
+        int voices;
+        int wave;     // 0..3 wavetable, 4 = FM
+        int filter;   // 0 = bypassed
+        int lfo_dest; // -1 = LFO off
+    };
+
+    struct Result {
+        Case c;
+        double ns_per_sample;
+        double realtime;
+    };
+
+    struct Options {
+        int sr = 48000;
+        int block = 128;      // AudioWorklet render quantum
+        float seconds = 1.0f; // audio rendered per measurement
+        int repeat = 3;       // best of N
+        bool full = false;
+        bool csv = false;
+        int threads = 1;
+        int min_voices = 8;   // per thread
+        int quality = 0;      // governor level, pinned
+        int filter_mode = 0;
+        int fm_ops = 2;       // operators sounding in the FM cases
+        int unison = 1;       // copies per oscillator
+        int mod = 0;          // modulation matrix routes
+    };
+
+    // Amount giving audible modulation for each destination
+    float lfo_amount_for(int dest) {
+        switch (dest) {
+            case 0: return 0.5f;    // semitones
+            case 1: return 800.0f;  // Hz
+            case 6: case 7: return 2.0f;
+            default: return 0.3f;
+        }
+    }
+
+    // Route k of --mod: even slots take an LFO (global), odd ones a per-voice
+    // source, cycling over the destinations every voice can take
+    void install_routes(Synth* synth, int count) {
+        static const int voice_src[] = {SYNTH_MOD_AMP_ENV, SYNTH_MOD_FILTER_ENV, SYNTH_MOD_VELOCITY, SYNTH_MOD_KEY};
+        static const int dests[] = {SYNTH_MOD_CUTOFF, SYNTH_MOD_PITCH, SYNTH_MOD_GAIN1, SYNTH_MOD_GAIN2, SYNTH_MOD_AMP};
+        for (int k = 0; k < count && k < SYNTH_MOD_ROUTES; ++k) {
+            int src = k % 2 == 0 ? SYNTH_MOD_LFO2 + (k / 2) % 2 : voice_src[(k / 2) % 4];
+            int dest = dests[k % 5];
+            synth_mod_route(synth, k, src, dest, dest == SYNTH_MOD_CUTOFF ? 500.0f : 0.1f);
+        }
+        synth_mod_lfo(synth, 2, 3.0f, SYNTH_LFO_TRIANGLE);
+        synth_mod_lfo(synth, 3, 0.7f, SYNTH_LFO_SINE);
+    }
+
+    Result run_case(const Case& c, const Options& o) {
+        Synth* synth = synth_create(o.sr, 2048);
+        synth_set_threads(synth, o.threads, o.min_voices);
+        synth_set_quality(synth, o.quality);
+        synth_filter_mode(synth, o.filter_mode);
+        synth_set_poly(synth, c.voices);
+        synth_set_wave1(synth, c.wave);
+        synth_set_wave2(synth, c.wave);
+        synth_set_detune2(synth, 0.07f);
+        for (int osc = 1; osc <= 2; ++osc) synth_unison(synth, osc, o.unison, 0.3f, 0.5f, 0.0f);
+        if (o.fm_ops > 2) {
+            for (int osc = 1; osc <= 2; ++osc) {
+                synth_fm_algorithm(synth, osc, 1);
+                synth_fm_feedback(synth, osc, 0.3f);
+                synth_fm_op(synth, osc, 3, 3.0f, 0.7f);
+                synth_fm_op(synth, osc, 4, 0.5f, 0.5f);
+                synth_fm_op_env(synth, osc, 2, 0.01f, 0.5f, 0.3f, 0.3f);
+                synth_fm_op_env(synth, osc, 3, 0.0f, 0.2f, 0.0f, 0.3f);
+            }
+        }
+        synth_filter_enable(synth, c.filter);
+        synth_filter_set(synth, 1500.0f, 0.5f);
+        synth_lfo_set(synth, 5.0f);
+        synth_lfo_dest(synth, c.lfo_dest < 0 ? 0 : c.lfo_dest);
+        synth_lfo_amount(synth, c.lfo_dest < 0 ? 0.0f : lfo_amount_for(c.lfo_dest));
+        install_routes(synth, o.mod);
+        for (int v = 0; v < c.voices; ++v) synth_note_on(synth, 36 + (v * 5) % 48, 0.8f);
+
+        std::vector<float> buf(o.block);
+        // Warm up past the attack so every voice is in steady state
+        for (int i = 0; i < o.sr / 4; i += o.block) synth_render(synth, buf.data(), o.block);
+
+        long frames = static_cast<long>(o.seconds * o.sr);
+        double best = 1e30;
+        for (int r = 0; r < o.repeat; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (long i = 0; i < frames; i += o.block) synth_render(synth, buf.data(), o.block);
+            double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            best = std::min(best, dt);
+        }
+        synth_destroy(synth);
+        long rendered = (frames + o.block - 1) / o.block * o.block;
+        return Result{c, best * 1e9 / rendered, (double)rendered / o.sr / best};
+    }
+
+    int memory_bytes(const Options& o) {
+        Synth* synth = synth_create(o.sr, 2048);
+        int bytes = synth_memory_bytes(synth);
+        synth_destroy(synth);
+        return bytes;
+    }
+
+    // Mean cost of a patch switch: alternate two snapshots under 8 held notes,
+    // timing load + block against the same blocks without a load
+    double measure_state_load(const Options& o) {
+        Synth* synth = synth_create(o.sr, 2048);
+        std::vector<unsigned char> patch[2];
+        for (int k = 0; k < 2; ++k) {
+            synth_set_wave1(synth, k ? 4 : 1);
+            synth_filter_set(synth, k ? 800.0f : 3000.0f, k ? 0.6f : 0.2f);
+            synth_lfo_dest(synth, k ? 1 : 0);
+            synth_lfo_amount(synth, k ? 500.0f : 0.3f);
+            patch[k].resize(synth_get_state(synth, nullptr, 0));
+            synth_get_state(synth, patch[k].data(), (int)patch[k].size());
+        }
+        for (int v = 0; v < 8; ++v) synth_note_on(synth, 48 + v * 3, 0.8f);
+        std::vector<float> buf(o.block);
+        const int loads = 2000;
+        double with = 1e30, without = 1e30;
+        for (int r = 0; r < o.repeat; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < loads; ++i) {
+                const std::vector<unsigned char>& p = patch[i & 1];
+                synth_load_state(synth, p.data(), (int)p.size());
+                synth_render(synth, buf.data(), o.block);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            for (int i = 0; i < loads; ++i) synth_render(synth, buf.data(), o.block);
+            auto t2 = std::chrono::steady_clock::now();
+            with = std::min(with, std::chrono::duration<double>(t1 - t0).count());
+            without = std::min(without, std::chrono::duration<double>(t2 - t1).count());
+        }
+        synth_destroy(synth);
+        return std::max(0.0, (with - without) * 1e9 / loads);
+    }
+
+    std::vector<Case> build_cases(const Options& o) {
+        std::vector<Case> cases;
+        const int voice_counts[] = {1, 2, 4, 8, 16, 24, 32, 64, MAX_VOICES};
+        if (o.full) {
+            for (int v : voice_counts)
+                for (int w = 0; w <= 4; ++w)
+                    for (int f = 0; f <= 1; ++f)
+                        for (int d = -1; d <= 7; ++d) cases.push_back({v, w, f, d});
+            return cases;
+        }
+        for (int v : voice_counts) cases.push_back({v, 1, 1, -1});
+        for (int w = 0; w <= 4; ++w) cases.push_back({8, w, 1, -1});
+        cases.push_back({8, 1, 0, -1});
+        cases.push_back({MAX_VOICES, 1, 0, -1});
+        cases.push_back({MAX_VOICES, 4, 0, -1});
+        for (int d = 0; d <= 7; ++d) cases.push_back({8, d >= 6 ? 4 : 1, 1, d});
+        return cases;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--full") o.full = true;
+        else if (a == "--csv") o.csv = true;
+        else if (a == "--seconds" && v) { o.seconds = (float)std::atof(v); ++i; }
+        else if (a == "--repeat" && v) { o.repeat = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--sr" && v) { o.sr = std::atoi(v); ++i; }
+        else if (a == "--block" && v) { o.block = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--threads" && v) { o.threads = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--min-voices" && v) { o.min_voices = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--quality" && v) { o.quality = std::atoi(v); ++i; }
+        else if (a == "--filter-mode" && v) { o.filter_mode = std::atoi(v); ++i; }
+        else if (a == "--fm-ops" && v) { o.fm_ops = std::atoi(v); ++i; }
+        else if (a == "--unison" && v) { o.unison = std::max(1, std::atoi(v)); ++i; }
+        else if (a == "--mod" && v) { o.mod = std::max(0, std::atoi(v)); ++i; }
+        else {
+            std::fprintf(stderr, "usage: wavetable_bench [--full] [--csv] [--seconds S] [--repeat N] [--sr N] [--block N]\n"
+                                 "                       [--threads N] [--min-voices N] [--quality L] [--filter-mode M]\n"
+                                 "                       [--fm-ops N] [--unison N] [--mod N]\n");
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    for (const Case& c : build_cases(o)) results.push_back(run_case(c, o));
+
+    if (o.csv) {
+        std::printf("voices,wave,filter,lfo_dest,ns_per_sample,realtime_factor\n");
+        for (const Result& r : results)
+            std::printf("%d,%d,%d,%d,%.2f,%.2f\n", r.c.voices, r.c.wave, r.c.filter, r.c.lfo_dest,
+                        r.ns_per_sample, r.realtime);
+        return 0;
+    }
+    std::printf("{\n  \"simd_width\": %d,\n  \"sample_rate\": %d,\n  \"block\": %d,\n  \"seconds\": %.3f,\n"
+                "  \"threads\": %d,\n  \"quality\": %d,\n  \"filter_mode\": %d,\n  \"fm_ops\": %d,\n"
+                "  \"unison\": %d,\n  \"mod_routes\": %d,\n  \"state_load_ns\": %.0f,\n  \"memory_bytes\": %d,\n  \"cases\": [\n",
+                SIMD_WIDTH, o.sr, o.block, o.seconds, o.threads, o.quality, o.filter_mode, o.fm_ops, o.unison, o.mod,
+                measure_state_load(o), memory_bytes(o));
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::printf("    {\"voices\": %d, \"wave\": %d, \"filter\": %d, \"lfo_dest\": %d, "
+                    "\"ns_per_sample\": %.2f, \"realtime_factor\": %.2f}%s\n",
+                    r.c.voices, r.c.wave, r.c.filter, r.c.lfo_dest, r.ns_per_sample, r.realtime,
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,321 @@
+// Offline bounce: renders Standard MIDI Files through the engine as fast as the
+// CPU allows and streams each one to a stereo float WAV.
+//
+//   wavetable_bounce [--patch P] [-o out.wav | --out-dir DIR] [--sr N] [--block N]
+//                    [--tail S] [--channel C] [--jobs N] [--threads N] in.mid...
+//
+// Every input gets its own engine, so --jobs renders that many files at once;
+// --threads additionally spreads each engine's voices over the worker pool.
+// Output defaults to the input path with a .wav extension.
+//
+// A patch is a text file of "name value..." lines ('#' starts a comment), one
+// per engine setter, e.g.
+//
+//   wave1 1
+//   detune2 0.07
+//   filter 900 0.5
+//   env 0.01 0.2 0.7 0.4
+//
+// MIDI mapping: notes and velocity; CC 1 is the mod wheel (a modulation
+// matrix source, see "mod_route"), CC 7 scales the patch amp, CC 74 sets the
+// cutoff (20 Hz..12 kHz), CC 71 the resonance, CC 64 holds notes, CC 120/123
+// release everything.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "midi_file.h"
+#include "wavetable_synth.h"
+#include "wav_writer.h"
+
+namespace {
+    void usage() {
+        std::fprintf(stderr,
+            "usage: wavetable_bounce [--patch P] [-o out.wav | --out-dir DIR] [--sr N] [--block N]\n"
+            "                        [--tail S] [--channel C] [--jobs N] [--threads N] in.mid...\n");
+    }
+
+    struct Options {
+        const char* patch = nullptr;
+        const char* out = nullptr;
+        std::string out_dir;
+        int sr = 48000;
+        int block = 4096;     // frames per synth_render call between events
+        float tail = 5.0f;    // max seconds rendered after the last event
+        int channel = 0;      // 1..16, 0 = all
+        int jobs = 1;
+        int threads = 1;
+    };
+
+    // One engine setter per patch line
+    struct PatchKey {
+        const char* name;
+        int args;
+        void (*apply)(Synth*, const float*);
+    };
+
+    const PatchKey PATCH_KEYS[] = {
+        {"amp", 1, [](Synth* s, const float* a) { synth_set_amp(s, a[0]); }},
+        {"smoothing", 1, [](Synth* s, const float* a) { synth_set_smoothing(s, a[0]); }},
+        {"poly", 1, [](Synth* s, const float* a) { synth_set_poly(s, (int)a[0]); }},
+        {"wave", 1, [](Synth* s, const float* a) { synth_set_wave(s, (int)a[0]); }},
+        {"wave1", 1, [](Synth* s, const float* a) { synth_set_wave1(s, (int)a[0]); }},
+        {"wave2", 1, [](Synth* s, const float* a) { synth_set_wave2(s, (int)a[0]); }},
+        {"crossfade", 1, [](Synth* s, const float* a) { synth_set_wave_crossfade(s, a[0]); }},
+        {"detune1", 1, [](Synth* s, const float* a) { synth_set_detune1(s, a[0]); }},
+        {"detune2", 1, [](Synth* s, const float* a) { synth_set_detune2(s, a[0]); }},
+        {"gain1", 1, [](Synth* s, const float* a) { synth_set_gain1(s, a[0]); }},
+        {"gain2", 1, [](Synth* s, const float* a) { synth_set_gain2(s, a[0]); }},
+        {"position1", 1, [](Synth* s, const float* a) { synth_set_position1(s, a[0]); }},
+        {"position2", 1, [](Synth* s, const float* a) { synth_set_position2(s, a[0]); }},
+        {"pan", 1, [](Synth* s, const float* a) { synth_set_pan(s, a[0]); }},
+        {"spread", 1, [](Synth* s, const float* a) { synth_set_spread(s, a[0]); }},
+        {"unison", 5, [](Synth* s, const float* a) { synth_unison(s, (int)a[0], (int)a[1], a[2], a[3], a[4]); }},
+        {"unison_phase", 2, [](Synth* s, const float* a) { synth_unison_phase(s, (int)a[0], a[1]); }},
+        {"mod_route", 4, [](Synth* s, const float* a) { synth_mod_route(s, (int)a[0], (int)a[1], (int)a[2], a[3]); }},
+        {"mod_lfo", 3, [](Synth* s, const float* a) { synth_mod_lfo(s, (int)a[0], a[1], (int)a[2]); }},
+        {"fm1", 3, [](Synth* s, const float* a) { synth_fm1(s, a[0], a[1], a[2]); }},
+        {"fm2", 3, [](Synth* s, const float* a) { synth_fm2(s, a[0], a[1], a[2]); }},
+        {"fm_algorithm", 2, [](Synth* s, const float* a) { synth_fm_algorithm(s, (int)a[0], (int)a[1]); }},
+        {"fm_feedback", 2, [](Synth* s, const float* a) { synth_fm_feedback(s, (int)a[0], a[1]); }},
+        {"fm_op", 4, [](Synth* s, const float* a) { synth_fm_op(s, (int)a[0], (int)a[1], a[2], a[3]); }},
+        {"fm_op_env", 6, [](Synth* s, const float* a) {
+            synth_fm_op_env(s, (int)a[0], (int)a[1], a[2], a[3], a[4], a[5]);
+        }},
+        {"env", 4, [](Synth* s, const float* a) { synth_set_env(s, a[0], a[1], a[2], a[3]); }},
+        {"filter", 2, [](Synth* s, const float* a) { synth_filter_set(s, a[0], a[1]); }},
+        {"filter_env", 4, [](Synth* s, const float* a) { synth_filter_env(s, a[0], a[1], a[2], a[3]); }},
+        {"filter_env_amount", 1, [](Synth* s, const float* a) { synth_filter_env_amount(s, a[0]); }},
+        {"filter_enable", 1, [](Synth* s, const float* a) { synth_filter_enable(s, (int)a[0]); }},
+        {"filter_mode", 1, [](Synth* s, const float* a) { synth_filter_mode(s, (int)a[0]); }},
+        {"lfo_rate", 1, [](Synth* s, const float* a) { synth_lfo_set(s, a[0]); }},
+        {"lfo_dest", 1, [](Synth* s, const float* a) { synth_lfo_dest(s, (int)a[0]); }},
+        {"lfo_amount", 1, [](Synth* s, const float* a) { synth_lfo_amount(s, a[0]); }},
+    };
+
+    struct PatchLine {
+        const PatchKey* key;
+        float args[6];
+    };
+
+    // Patch values the MIDI controllers start from (engine defaults otherwise)
+    struct ControlBase {
+        float amp = 0.4f;
+        float cutoff = 1200.0f;
+        float resonance = 0.3f;
+    };
+
+    // Parse the patch once; each job applies it to its own engine
+    bool read_patch(const char* path, std::vector<PatchLine>& out, ControlBase& base) {
+        std::FILE* f = std::fopen(path, "r");
+        if (!f) { std::fprintf(stderr, "%s: cannot open\n", path); return false; }
+        char line[256];
+        for (int no = 1; std::fgets(line, sizeof(line), f); ++no) {
+            if (char* hash = std::strchr(line, '#')) *hash = 0;
+            char name[64];
+            int used = 0;
+            if (std::sscanf(line, "%63s%n", name, &used) != 1) continue;
+            const PatchKey* key = nullptr;
+            for (const PatchKey& k : PATCH_KEYS) if (std::strcmp(k.name, name) == 0) key = &k;
+            PatchLine pl{key, {}};
+            int got = 0;
+            for (const char* p = line + used; key && got < key->args; ++got) {
+                char* end = nullptr;
+                pl.args[got] = std::strtof(p, &end);
+                if (end == p) break;
+                p = end;
+            }
+            if (!key || got != key->args) {
+                std::fprintf(stderr, "%s:%d: %s '%s'\n", path, no, key ? "wrong argument count for" : "unknown setting", name);
+                std::fclose(f);
+                return false;
+            }
+            if (std::strcmp(name, "amp") == 0) base.amp = pl.args[0];
+            if (std::strcmp(name, "filter") == 0) { base.cutoff = pl.args[0]; base.resonance = pl.args[1]; }
+            out.push_back(pl);
+        }
+        std::fclose(f);
+        return true;
+    }
+
+    struct Job {
+        std::string in;
+        std::string out;
+    };
+
+    struct Shared {
+        const Options* o = nullptr;
+        const std::vector<PatchLine>* patch = nullptr;
+        ControlBase base{};
+        std::mutex log{};
+        std::atomic<int> failures{0};
+    };
+
+    // Render frames of stereo audio in block-sized chunks straight to the WAV;
+    // planar holds the engine's left/right output, frame the interleaved copy
+    bool render_frames(Synth* synth, WavWriter& wav, std::vector<float>& planar, std::vector<float>& frame,
+                       long frames) {
+        int block = (int)planar.size() / 2;
+        while (frames > 0) {
+            int n = frames < block ? (int)frames : block;
+            synth_render_planar(synth, planar.data(), block, 2, n, nullptr, 0, 0);
+            for (int i = 0; i < n; ++i) {
+                frame[2 * i] = planar[i];
+                frame[2 * i + 1] = planar[block + i];
+            }
+            if (!wav.write(frame.data(), n)) return false;
+            frames -= n;
+        }
+        return true;
+    }
+
+    void bounce(const Job& job, Shared& sh) {
+        const Options& o = *sh.o;
+        auto fail = [&](const char* what) {
+            std::lock_guard<std::mutex> lk(sh.log);
+            std::fprintf(stderr, "%s: %s\n", job.in.c_str(), what);
+            sh.failures.fetch_add(1);
+        };
+        std::vector<MidiEvent> events;
+        std::string err;
+        if (!midi_read(job.in.c_str(), events, err)) { fail(err.c_str()); return; }
+
+        Synth* synth = synth_create(o.sr, 2048);
+        synth_set_threads(synth, o.threads, 4);
+        for (const PatchLine& pl : *sh.patch) pl.key->apply(synth, pl.args);
+        WavWriter wav;
+        if (!wav.open(job.out.c_str(), o.sr, 2)) {
+            synth_destroy(synth);
+            fail("cannot open output");
+            return;
+        }
+
+        std::vector<float> planar(2 * o.block), frame(2 * o.block);
+        std::vector<int> held; // note-offs deferred by the sustain pedal
+        bool sustain = false, ok = true;
+        float cutoff = sh.base.cutoff, resonance = sh.base.resonance;
+        long done = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const MidiEvent& e : events) {
+            int ch = (e.status & 0x0f) + 1;
+            if (o.channel && ch != o.channel) continue;
+            long at = std::lround(e.seconds * o.sr);
+            if (at > done) {
+                ok = ok && render_frames(synth, wav, planar, frame, at - done);
+                done = at;
+            }
+            uint8_t kind = e.status & 0xf0;
+            if (kind == 0x90 && e.data2 > 0) {
+                // A key struck again under the pedal is held by the key, not the pedal
+                held.erase(std::remove(held.begin(), held.end(), (int)e.data1), held.end());
+                synth_note_on(synth, e.data1, e.data2 / 127.0f);
+            } else if (kind == 0x80 || kind == 0x90) {
+                if (sustain) held.push_back(e.data1);
+                else synth_note_off_midi(synth, e.data1);
+            } else if (kind == 0xb0) {
+                float v = e.data2 / 127.0f;
+                switch (e.data1) {
+                    case 1: synth_mod_wheel(synth, v); break;
+                    case 7: synth_set_amp(synth, sh.base.amp * v); break;
+                    case 64:
+                        sustain = e.data2 >= 64;
+                        if (!sustain) {
+                            for (int n : held) synth_note_off_midi(synth, n);
+                            held.clear();
+                        }
+                        break;
+                    case 71:
+                        resonance = v;
+                        synth_filter_set(synth, cutoff, resonance);
+                        break;
+                    case 74:
+                        cutoff = 20.0f * std::pow(600.0f, v);
+                        synth_filter_set(synth, cutoff, resonance);
+                        break;
+                    case 120: case 123: held.clear(); synth_note_off(synth); break;
+                    default: break;
+                }
+            }
+        }
+        // Let the releases ring out, up to the tail limit
+        synth_note_off(synth);
+        long tail_end = done + (long)(o.tail * o.sr);
+        while (ok && done < tail_end && synth_active_voices(synth) > 0) {
+            long n = std::min<long>(o.block, tail_end - done);
+            ok = render_frames(synth, wav, planar, frame, n);
+            done += n;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        wav.close();
+        synth_destroy(synth);
+        if (!ok) { fail("write failed"); return; }
+
+        double seconds = (double)done / o.sr;
+        std::lock_guard<std::mutex> lk(sh.log);
+        std::fprintf(stderr, "%s -> %s: %.2f s rendered in %.3f s (%.1fx realtime)\n", job.in.c_str(),
+                     job.out.c_str(), seconds, elapsed, elapsed > 0 ? seconds / elapsed : 0.0);
+    }
+
+    std::string output_for(const std::string& in, const Options& o) {
+        if (o.out) return o.out;
+        std::string base = in;
+        std::size_t dot = base.find_last_of('.');
+        std::size_t slash = base.find_last_of('/');
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) base.erase(dot);
+        if (!o.out_dir.empty()) {
+            base = base.substr(slash == std::string::npos ? 0 : slash + 1);
+            base = o.out_dir + "/" + base;
+        }
+        return base + ".wav";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a.size() > 1 && a[0] == '-' && !v) { usage(); return 2; }
+        if (a == "--patch") o.patch = v;
+        else if (a == "-o") o.out = v;
+        else if (a == "--out-dir") o.out_dir = v;
+        else if (a == "--sr") o.sr = std::atoi(v);
+        else if (a == "--block") o.block = std::max(1, std::atoi(v));
+        else if (a == "--tail") o.tail = (float)std::atof(v);
+        else if (a == "--channel") o.channel = std::atoi(v);
+        else if (a == "--jobs") o.jobs = std::max(1, std::atoi(v));
+        else if (a == "--threads") o.threads = std::max(1, std::atoi(v));
+        else if (a[0] == '-') { usage(); return 2; }
+        else { inputs.push_back(a); continue; }
+        ++i;
+    }
+    if (inputs.empty() || (o.out && inputs.size() > 1) || o.sr <= 0) { usage(); return 2; }
+
+    std::vector<PatchLine> patch;
+    ControlBase base;
+    if (o.patch && !read_patch(o.patch, patch, base)) return 1;
+
+    std::vector<Job> jobs;
+    for (const std::string& in : inputs) jobs.push_back({in, output_for(in, o)});
+    Shared sh{&o, &patch, base};
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t j; (j = next.fetch_add(1)) < jobs.size();) bounce(jobs[j], sh);
+    };
+    std::vector<std::thread> pool;
+    int n = std::min<int>(o.jobs, (int)jobs.size());
+    for (int t = 1; t < n; ++t) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+    return sh.failures.load() ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Standard MIDI File reader (formats 0 and 1). All tracks are merged into one
+// time-ordered list of channel messages with times in seconds, following the
+// tempo map; meta and sysex events are dropped.
+struct MidiEvent {
+    double seconds;
+    uint8_t status; // channel message status byte (0x80..0xEF)
+    uint8_t data1;
+    uint8_t data2;
+};
+
+namespace midi_detail {
+    struct TickEvent {
+        uint32_t tick;
+        uint32_t order; // file order, keeps simultaneous events stable
+        uint8_t status, data1, data2;
+    };
+
+    struct Tempo {
+        uint32_t tick;
+        uint32_t order;
+        uint32_t usec_per_quarter;
+    };
+
+    struct Reader {
+        const std::vector<uint8_t>& buf;
+        std::size_t pos;
+        std::size_t end;
+
+        bool more() const { return pos < end; }
+        uint8_t u8() { return pos < end ? buf[pos++] : 0; }
+        uint32_t be(int bytes) {
+            uint32_t v = 0;
+            for (int i = 0; i < bytes; ++i) v = (v << 8) | u8();
+            return v;
+        }
+        uint32_t vlq() {
+            uint32_t v = 0;
+            for (int i = 0; i < 4; ++i) {
+                uint8_t b = u8();
+                v = (v << 7) | (b & 0x7f);
+                if (!(b & 0x80)) break;
+            }
+            return v;
+        }
+    };
+
+    inline int data_bytes(uint8_t status) {
+        uint8_t kind = status & 0xf0;
+        return (kind == 0xc0 || kind == 0xd0) ? 1 : 2;
+    }
+
+    inline bool parse_track(Reader r, std::vector<TickEvent>& events, std::vector<Tempo>& tempos, uint32_t& order) {
+        uint32_t tick = 0;
+        uint8_t running = 0;
+        while (r.more()) {
+            tick += r.vlq();
+            uint8_t status = r.u8();
+            if (status == 0xff) { // meta
+                uint8_t type = r.u8();
+                uint32_t len = r.vlq();
+                if (type == 0x51 && len == 3) {
+                    tempos.push_back({tick, order++, r.be(3)});
+                } else {
+                    r.pos += len;
+                }
+                if (type == 0x2f) break; // end of track
+                continue;
+            }
+            if (status == 0xf0 || status == 0xf7) { // sysex
+                r.pos += r.vlq();
+                continue;
+            }
+            uint8_t d1;
+            if (status & 0x80) {
+                running = status;
+                d1 = r.u8();
+            } else {
+                if (!running) return false; // data byte without a status
+                d1 = status;
+                status = running;
+            }
+            uint8_t d2 = data_bytes(status) == 2 ? r.u8() : 0;
+            events.push_back({tick, order++, status, d1, d2});
+        }
+        return true;
+    }
+}
+
+// Read path into events (sorted by time). Returns false with a message in err.
+inline bool midi_read(const char* path, std::vector<MidiEvent>& out, std::string& err) {
+    using namespace midi_detail;
+    out.clear();
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) { err = "cannot open"; return false; }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0;) buf.insert(buf.end(), chunk, chunk + n);
+    std::fclose(f);
+
+    Reader hdr{buf, 0, buf.size()};
+    uint32_t magic = hdr.be(4);
+    uint32_t hlen = hdr.be(4);
+    if (magic != 0x4d546864 || hlen < 6) { err = "not a MIDI file"; return false; } // "MThd"
+    uint32_t format = hdr.be(2);
+    uint32_t ntracks = hdr.be(2);
+    uint32_t division = hdr.be(2);
+    if (format > 1) { err = "format 2 MIDI files are not supported"; return false; }
+    if (division == 0 || (division & 0x8000 && !(division & 0xff))) { err = "bad time division"; return false; }
+
+    std::vector<TickEvent> events;
+    std::vector<Tempo> tempos;
+    uint32_t order = 0;
+    std::size_t pos = 8 + static_cast<std::size_t>(hlen);
+    for (uint32_t found = 0; found < ntracks && pos + 8 <= buf.size();) {
+        Reader c{buf, pos, buf.size()};
+        uint32_t id = c.be(4);
+        uint32_t len = c.be(4);
+        std::size_t end = std::min(buf.size(), c.pos + len);
+        pos = end;
+        if (id != 0x4d54726b) continue; // not "MTrk": unknown chunks are skipped
+        if (!parse_track(Reader{buf, c.pos, end}, events, tempos, order)) { err = "corrupt track"; return false; }
+        ++found;
+    }
+
+    auto by_time = [](const auto& a, const auto& b) { return a.tick != b.tick ? a.tick < b.tick : a.order < b.order; };
+    std::sort(events.begin(), events.end(), by_time);
+    std::sort(tempos.begin(), tempos.end(), by_time);
+
+    // Ticks to seconds along the tempo map (SMPTE divisions have fixed tick length)
+    bool smpte = division & 0x8000;
+    double smpte_tick = smpte ? 1.0 / ((double)-(int8_t)(division >> 8) * (double)(division & 0xff)) : 0.0;
+    double sec_per_tick = smpte ? smpte_tick : 0.5 / (double)division; // 120 bpm until a tempo event
+    double base_sec = 0.0;
+    uint32_t base_tick = 0;
+    std::size_t ti = 0;
+    out.reserve(events.size());
+    for (const TickEvent& e : events) {
+        while (!smpte && ti < tempos.size() && tempos[ti].tick <= e.tick) {
+            base_sec += (double)(tempos[ti].tick - base_tick) * sec_per_tick;
+            base_tick = tempos[ti].tick;
+            sec_per_tick = tempos[ti].usec_per_quarter * 1e-6 / (double)division;
+            ++ti;
+        }
+        out.push_back({base_sec + (double)(e.tick - base_tick) * sec_per_tick, e.status, e.data1, e.data2});
+    }
+    return true;
+}
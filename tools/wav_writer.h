@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Streaming 32-bit float WAV writer. Samples are appended as they are rendered;
+// the RIFF/data sizes are patched in close(), so nothing is held in memory.
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter() { close(); }
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    bool open(const char* path, int sample_rate, int channels) {
+        close();
+        f_ = std::fopen(path, "wb");
+        if (!f_) return false;
+        channels_ = channels;
+        frames_ = 0;
+        write_header(sample_rate);
+        return true;
+    }
+
+    // Interleaved frames
+    bool write(const float* samples, int frames) {
+        if (!f_) return false;
+        std::size_t n = static_cast<std::size_t>(frames) * channels_;
+        if (std::fwrite(samples, sizeof(float), n, f_) != n) return false;
+        frames_ += static_cast<uint32_t>(frames);
+        return true;
+    }
+
+    void close() {
+        if (!f_) return;
+        uint32_t data_bytes = frames_ * channels_ * 4;
+        std::fseek(f_, 4, SEEK_SET);
+        put32(36 + data_bytes);
+        std::fseek(f_, 40, SEEK_SET);
+        put32(data_bytes);
+        std::fclose(f_);
+        f_ = nullptr;
+    }
+
+private:
+    void put16(uint16_t v) { uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)}; std::fwrite(b, 1, 2, f_); }
+    void put32(uint32_t v) {
+        uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+        std::fwrite(b, 1, 4, f_);
+    }
+    void write_header(int sample_rate) {
+        std::fwrite("RIFF", 1, 4, f_); put32(36);
+        std::fwrite("WAVEfmt ", 1, 8, f_); put32(16);
+        put16(3); // IEEE float
+        put16(static_cast<uint16_t>(channels_));
+        put32(static_cast<uint32_t>(sample_rate));
+        put32(static_cast<uint32_t>(sample_rate) * channels_ * 4);
+        put16(static_cast<uint16_t>(channels_ * 4));
+        put16(32);
+        std::fwrite("data", 1, 4, f_); put32(0);
+    }
+
+    std::FILE* f_ = nullptr;
+    int channels_ = 1;
+    uint32_t frames_ = 0;
+};
@@ -21,32 +21,122 @@ async function init() {
   setStatus();
   audioCtx.addEventListener('statechange', () => setStatus());
 
+  // player.js compiles the wasm once (SIMD or scalar build) and hands the
+  // module to the worklet
   try {
-    await audioCtx.audioWorklet.addModule('worklet/synth-processor.js');
-    node = new AudioWorkletNode(audioCtx, 'synth-processor');
-    node.connect(audioCtx.destination);
+    const { createWasmDSPNode } = await import('./player.js');
+    node = await createWasmDSPNode(audioCtx);
   } catch (e) {
     log('Failed to load worklet: ' + (e && e.message ? e.message : e));
     setStatus(' | worklet load failed');
     return;
   }
-  node.connect(audioCtx.destination);
 
-  // Messages from worklet (logs/metrics)
+  // Engine telemetry (SynthStats words per part, see src/synth_stats.h), summed
+  // over parts into the status line. Polled from shared memory when the worklet
+  // provides it, otherwise taken from its periodic 'stats' messages.
+  const STATS_WORDS = 19;
+  const pct = (x) => `${(x * 100).toFixed(0)}%`;
+  function showStats(u32, f32) {
+    let load = 0, avg = 0, peak = 0, voices = 0, steals = 0, overruns = 0, dropouts = 0, nans = 0, quality = 0;
+    for (let o = 0; o + STATS_WORDS <= u32.length; o += STATS_WORDS) {
+      load += f32[o + 4]; peak += f32[o + 5]; avg += f32[o + 6];
+      voices += u32[o + 7]; steals += u32[o + 9]; nans += u32[o + 12];
+      overruns += u32[o + 14]; dropouts += u32[o + 15]; quality = Math.max(quality, u32[o + 18]);
+    }
+    setStatus(`| DSP ${pct(load)} avg ${pct(avg)} peak ${pct(peak)} | voices=${voices} steals=${steals}` +
+              ` | overruns=${overruns} dropouts=${dropouts}${quality ? ` | economy ${quality}/4` : ''}` +
+              `${nans ? ` NaN=${nans}` : ''}`);
+  }
+
+  // UI messages to the worklet; held back while a preset snapshot is applied,
+  // since the snapshot already carries every value
+  let holdMessages = false;
+  function post(msg, transfer) { if (!holdMessages) node.port.postMessage(msg, transfer); }
+
+  // Patch snapshots (synth_get_state) requested from the worklet, by request id
+  const stateRequests = new Map();
+  let stateRequestId = 0;
+  function requestState() {
+    return new Promise((resolve) => {
+      const id = ++stateRequestId;
+      stateRequests.set(id, resolve);
+      node.port.postMessage({ type: 'state_get', id });
+      setTimeout(() => { if (stateRequests.delete(id)) resolve(null); }, 500);
+    });
+  }
+
+  // Messages from worklet (logs/stats)
   node.port.onmessage = (ev) => {
     const m = ev.data || {};
     if (m.type === 'ready') {
-      log(`Worklet ready, sr=${m.sr}`);
+      if (m.ring) openRing(m.ring);
+      if (m.stats) {
+        const u32 = new Uint32Array(m.stats), f32 = new Float32Array(m.stats);
+        setInterval(() => showStats(u32, f32), 250);
+      }
+      log(`Worklet ready, sr=${m.sr}${ring ? ' (shared event ring)' : ''}${m.memory ? `, ${(m.memory / 1024).toFixed(0)} KiB engine memory` : ''}`);
     } else if (m.type === 'log') {
       log(m.msg);
     } else if (m.type === 'error') {
       log(`ERROR: ${m.msg}`);
-    } else if (m.type === 'metrics') {
-      const { rms, frames } = m;
-      setStatus(`| frames=${frames} rms=${rms.toFixed(4)}`);
+    } else if (m.type === 'wavetable') {
+      // Table loaded into the engine and selected there: show it on the oscillator
+      const sel = document.getElementById(m.osc === 2 ? 'wave2' : 'wave1');
+      if (sel && m.wave >= 0) {
+        let opt = sel.querySelector(`option[value="${m.wave}"]`);
+        if (!opt) { opt = document.createElement('option'); opt.value = String(m.wave); sel.appendChild(opt); }
+        opt.textContent = `User: ${m.name}`;
+        sel.value = String(m.wave);
+        updateFmVisibility();
+      }
+      log(m.wave >= 0 ? `Wavetable ${m.name}: ${m.frames} frames` : `Wavetable ${m.name} rejected`);
+    } else if (m.type === 'stats') {
+      showStats(new Uint32Array(m.words), new Float32Array(m.words));
+    } else if (m.type === 'state') {
+      const resolve = stateRequests.get(m.id);
+      if (resolve) { stateRequests.delete(m.id); resolve(m.data ? new Uint8Array(m.data) : null); }
     }
   };
 
+  // Engine events (SynthEventType in src/wavetable_synth.h). Notes are stamped
+  // with a context frame a fixed lookahead ahead, so the worklet applies them at
+  // that exact sample instead of the next block boundary. With cross-origin
+  // isolation they go straight into a SharedArrayBuffer ring the worklet drains
+  // each block; otherwise they are posted.
+  const EV_NOTE_ON = 1, EV_NOTE_OFF = 2;
+  const EVENT_LOOKAHEAD_S = 0.01;
+  let ring = null;
+  function openRing(sab) {
+    ring = { u32: new Uint32Array(sab), i32: new Int32Array(sab), f32: new Float32Array(sab) };
+    ring.cap = ring.u32[2];
+  }
+  function eventFrame() {
+    // currentTime only moves per render quantum; interpolate the output clock
+    // instead and add back the output latency to land on the render timeline
+    const ts = audioCtx.getOutputTimestamp ? audioCtx.getOutputTimestamp() : null;
+    let t = audioCtx.currentTime;
+    if (ts && ts.contextTime > 0) {
+      const latency = audioCtx.outputLatency || audioCtx.baseLatency || 0;
+      t = ts.contextTime + (performance.now() - ts.performanceTime) / 1000 + latency;
+    }
+    return Math.round((t + EVENT_LOOKAHEAD_S) * audioCtx.sampleRate) >>> 0;
+  }
+  function sendEvent(frame, type, i = 0, a = 0, b = 0, c = 0, d = 0) {
+    if (ring) {
+      const { u32, i32, f32, cap } = ring;
+      const w = Atomics.load(u32, 0);
+      if (((w - Atomics.load(u32, 1)) >>> 0) >= cap) return; // full; worklet stalled
+      const e = 8 + (w & (cap - 1)) * 8;
+      u32[e] = frame; i32[e + 1] = type; i32[e + 2] = i;
+      f32[e + 3] = a; f32[e + 4] = b; f32[e + 5] = c; f32[e + 6] = d;
+      u32[e + 7] = 0; // part: this page drives a single engine
+      Atomics.store(u32, 0, (w + 1) >>> 0);
+      return;
+    }
+    post({ type: 'events', events: [frame, type, i, a, b, c, d] });
+  }
+
   // UI controls - Oscillators
   const wave1 = document.getElementById('wave1');
   const wave2 = document.getElementById('wave2');
@@ -60,6 +150,43 @@ async function init() {
   const fm2car = document.getElementById('fm2car');
   const fm2mod = document.getElementById('fm2mod');
   const fm2idx = document.getElementById('fm2idx');
+  // Four-operator controls: algorithm, operator 4 feedback, ratio/level of operators 3 and 4
+  const fmx = [1, 2].map(n => {
+    const el = k => document.getElementById(`fm${n}${k}`);
+    return { alg: el('alg'), fb: el('fb'), r3: el('r3'), l3: el('l3'), r4: el('r4'), l4: el('l4') };
+  });
+  function fmExtra(n) {
+    const x = fmx[n - 1];
+    const msg = {};
+    if (x.alg) msg.fm_algorithm = parseInt(x.alg.value, 10) | 0;
+    if (x.fb) msg.fm_feedback = +x.fb.value;
+    if (x.r3 && x.l3 && x.r4 && x.l4) {
+      msg.fm_ops = [{ op: 3, ratio: +x.r3.value, level: +x.l3.value }, { op: 4, ratio: +x.r4.value, level: +x.l4.value }];
+    }
+    for (const k of ['fb', 'r3', 'l3', 'r4', 'l4']) {
+      const v = document.getElementById(`fm${n}${k}Val`);
+      if (v && x[k]) v.textContent = (+x[k].value).toFixed(2);
+    }
+    return msg;
+  }
+  // Unison stack controls: copies, detune, curve, stereo width, phase randomness
+  const unx = [1, 2].map(n => {
+    const el = k => document.getElementById(`uni${n}${k}`);
+    return { voices: el('n'), detune: el('det'), curve: el('cur'), width: el('wid'), random: el('rnd') };
+  });
+  function unisonExtra(n) {
+    const x = unx[n - 1];
+    if (!x.voices) return {};
+    const unison = {};
+    for (const k in x) if (x[k]) unison[k] = +x[k].value;
+    for (const [k, id] of [['voices', 'n'], ['detune', 'det'], ['curve', 'cur'], ['width', 'wid'], ['random', 'rnd']]) {
+      const v = document.getElementById(`uni${n}${id}Val`);
+      if (v && x[k]) v.textContent = k === 'voices' ? `${x[k].value}` : (+x[k].value).toFixed(2);
+    }
+    return { unison };
+  }
+  const pos1 = document.getElementById('pos1');
+  const pos2 = document.getElementById('pos2');
   const presetSelect = document.getElementById('presetSelect');
   function sendOsc1() {
     const w = wave1 ? (parseInt(wave1.value,10)|0) : 0;
@@ -68,13 +195,15 @@ async function init() {
     const fm_car = fm1car ? (+fm1car.value) : undefined;
     const fm_mod = fm1mod ? (+fm1mod.value) : undefined;
     const fm_indx = fm1idx ? (+fm1idx.value) : undefined;
-    node.port.postMessage({ type: 'osc1', wave: w, detune: d, gain: g, fm_car, fm_mod, fm_indx });
+    const position = pos1 ? (+pos1.value) : undefined;
+    post({ type: 'osc1', wave: w, detune: d, gain: g, fm_car, fm_mod, fm_indx, position, ...fmExtra(1), ...unisonExtra(1) });
     const dv = document.getElementById('det1Val'); if (dv) dv.textContent = `${d.toFixed(2)} st`;
     const gv = document.getElementById('gain1Val'); if (gv && gain1) gv.textContent = `${(+gain1.value).toFixed(2)}`;
     const set = (id, val, suf='') => { const el = document.getElementById(id); if (el) el.textContent = `${val.toFixed(2)}${suf}`; };
     if (fm1car) set('fm1carVal', +fm1car.value);
     if (fm1mod) set('fm1modVal', +fm1mod.value);
     if (fm1idx) set('fm1idxVal', +fm1idx.value);
+    if (pos1) set('pos1Val', +pos1.value);
   }
   function sendOsc2() {
     const w = wave2 ? (parseInt(wave2.value,10)|0) : 0;
@@ -83,13 +212,15 @@ async function init() {
     const fm_car = fm2car ? (+fm2car.value) : undefined;
     const fm_mod = fm2mod ? (+fm2mod.value) : undefined;
     const fm_indx = fm2idx ? (+fm2idx.value) : undefined;
-    node.port.postMessage({ type: 'osc2', wave: w, detune: d, gain: g, fm_car, fm_mod, fm_indx });
+    const position = pos2 ? (+pos2.value) : undefined;
+    post({ type: 'osc2', wave: w, detune: d, gain: g, fm_car, fm_mod, fm_indx, position, ...fmExtra(2), ...unisonExtra(2) });
     const dv = document.getElementById('det2Val'); if (dv) dv.textContent = `${d.toFixed(2)} st`;
     const gv = document.getElementById('gain2Val'); if (gv && gain2) gv.textContent = `${(+gain2.value).toFixed(2)}`;
     const set = (id, val, suf='') => { const el = document.getElementById(id); if (el) el.textContent = `${val.toFixed(2)}${suf}`; };
     if (fm2car) set('fm2carVal', +fm2car.value);
     if (fm2mod) set('fm2modVal', +fm2mod.value);
     if (fm2idx) set('fm2idxVal', +fm2idx.value);
+    if (pos2) set('pos2Val', +pos2.value);
   }
   if (wave1) wave1.addEventListener('change', sendOsc1);
   if (wave2) wave2.addEventListener('change', sendOsc2);
@@ -111,9 +242,59 @@ async function init() {
   if (fm1car) fm1car.addEventListener('input', sendOsc1);
   if (fm1mod) fm1mod.addEventListener('input', sendOsc1);
   if (fm1idx) fm1idx.addEventListener('input', sendOsc1);
+  for (const el of Object.values(fmx[0])) if (el) el.addEventListener(el.tagName === 'SELECT' ? 'change' : 'input', sendOsc1);
   if (fm2car) fm2car.addEventListener('input', sendOsc2);
   if (fm2mod) fm2mod.addEventListener('input', sendOsc2);
   if (fm2idx) fm2idx.addEventListener('input', sendOsc2);
+  for (const el of Object.values(fmx[1])) if (el) el.addEventListener(el.tagName === 'SELECT' ? 'change' : 'input', sendOsc2);
+  if (pos1) pos1.addEventListener('input', sendOsc1);
+  if (pos2) pos2.addEventListener('input', sendOsc2);
+  for (const el of Object.values(unx[0])) if (el) el.addEventListener('input', sendOsc1);
+  for (const el of Object.values(unx[1])) if (el) el.addEventListener('input', sendOsc2);
+
+  // User wavetables: a WAV of single-cycle frames (WT_FRAME_SIZE samples each,
+  // as wavetable editors export them) is decoded here and sent to the worklet,
+  // which keeps it in the WASM heap where the engine reads it
+  const WT_FRAME_SIZE = 2048;
+  const WT_MAX_FRAMES = 256;
+  function decodeWav(buf) {
+    const dv = new DataView(buf);
+    if (dv.byteLength < 12 || dv.getUint32(0) !== 0x52494646 || dv.getUint32(8) !== 0x57415645) return null; // RIFF....WAVE
+    let format = 1, channels = 1, bits = 16, data = null;
+    for (let p = 12; p + 8 <= dv.byteLength;) {
+      const id = dv.getUint32(p), len = dv.getUint32(p + 4, true);
+      if (id === 0x666d7420) { // 'fmt '
+        format = dv.getUint16(p + 8, true); channels = dv.getUint16(p + 10, true); bits = dv.getUint16(p + 22, true);
+      } else if (id === 0x64617461) { // 'data'
+        data = { off: p + 8, len: Math.min(len, dv.byteLength - p - 8) };
+      }
+      p += 8 + len + (len & 1);
+    }
+    const bytes = bits >> 3;
+    if (!data || !bytes || !channels) return null;
+    const n = Math.floor(data.len / (bytes * channels));
+    const out = new Float32Array(n);
+    for (let i = 0; i < n; i++) {
+      const o = data.off + i * bytes * channels; // first channel only
+      if (format === 3 && bits === 32) out[i] = dv.getFloat32(o, true);
+      else if (bits === 16) out[i] = dv.getInt16(o, true) / 32768;
+      else if (bits === 24) out[i] = (dv.getUint8(o) | (dv.getUint8(o + 1) << 8) | (dv.getInt8(o + 2) << 16)) / 8388608;
+      else if (bits === 32) out[i] = dv.getInt32(o, true) / 2147483648;
+      else return null;
+    }
+    return out;
+  }
+  async function loadWavetable(osc, file) {
+    const samples = decodeWav(await file.arrayBuffer());
+    const frames = samples ? Math.min(Math.floor(samples.length / WT_FRAME_SIZE), WT_MAX_FRAMES) : 0;
+    if (!frames) { log(`Wavetable ${file.name}: expected a WAV of ${WT_FRAME_SIZE}-sample frames`); return; }
+    const data = samples.slice(0, frames * WT_FRAME_SIZE);
+    post({ type: 'wavetable', osc, name: file.name, frames, size: WT_FRAME_SIZE, data }, [data.buffer]);
+  }
+  [[1, 'wt1file'], [2, 'wt2file']].forEach(([osc, id]) => {
+    const el = document.getElementById(id);
+    if (el) el.addEventListener('change', () => { if (el.files && el.files[0]) loadWavetable(osc, el.files[0]); });
+  });
 
   // Piano keyboard mapping starting at 'A' for C4: A W S E D F T G Y H U J K
   const KEY_TO_MIDI = { 'a':60,'w':61,'s':62,'e':63,'d':64,'f':65,'t':66,'g':67,'y':68,'h':69,'u':70,'j':71,'k':72 };
@@ -121,10 +302,10 @@ async function init() {
   const pressed = new Set();
 
   function noteOn(midi, velocity = 1.0) {
-    node.port.postMessage({ type: 'note_on', midi, velocity });
+    sendEvent(eventFrame(), EV_NOTE_ON, midi, velocity);
   }
   function noteOff(midi) {
-    node.port.postMessage({ type: 'note_off', midi });
+    sendEvent(eventFrame(), EV_NOTE_OFF, midi);
   }
 
   async function ensureRunning() {
@@ -181,7 +362,7 @@ async function init() {
   const rel = document.getElementById('rel');
   function sendEnv() {
     if (!atk || !dec || !sus || !rel) return;
-    node.port.postMessage({ type: 'env', attack: +atk.value, decay: +dec.value, sustain: +sus.value, release: +rel.value });
+    post({ type: 'env', attack: +atk.value, decay: +dec.value, sustain: +sus.value, release: +rel.value });
   }
   [atk, dec, sus, rel].forEach(el => el && el.addEventListener('input', sendEnv));
 
@@ -189,7 +370,7 @@ async function init() {
   const poly = document.getElementById('poly');
   if (poly) poly.addEventListener('input', () => {
     const n = parseInt(poly.value,10)|0;
-    node.port.postMessage({ type: 'poly', value: n });
+    post({ type: 'poly', value: n });
     const pv = document.getElementById('polyVal');
     if (pv) pv.textContent = `${n} voices`;
   });
@@ -198,29 +379,43 @@ async function init() {
   const master = document.getElementById('master');
   if (master) master.addEventListener('input', () => {
     const val = +master.value;
-    node.port.postMessage({ type: 'amp', value: val });
+    post({ type: 'amp', value: val });
     const mv = document.getElementById('masterVal'); if (mv) mv.textContent = `${val.toFixed(2)}`;
   });
 
+  // Stereo placement: master pan and per-note voice spread
+  const pan = document.getElementById('pan');
+  const spread = document.getElementById('spread');
+  for (const [el, type] of [[pan, 'pan'], [spread, 'spread']]) {
+    if (el) el.addEventListener('input', () => {
+      const val = +el.value;
+      post({ type, value: val });
+      const kv = document.getElementById(type + 'Val'); if (kv) kv.textContent = val.toFixed(2);
+    });
+  }
+
   // Filter controls
   const fc = document.getElementById('fc');
   const res = document.getElementById('res');
   const famt = document.getElementById('famt');
   function sendFilter() {
     if (!fc || !res) return;
-    node.port.postMessage({ type: 'filter', cutoff: +fc.value, resonance: +res.value });
+    post({ type: 'filter', cutoff: +fc.value, resonance: +res.value });
     const fcVal = document.getElementById('fcVal');
     if (fcVal) fcVal.textContent = `${(+fc.value/1000).toFixed(2)} kHz`;
     const resVal = document.getElementById('resVal');
     if (resVal) resVal.textContent = (+res.value).toFixed(2);
   }
-  function sendFamt() { if (famt) node.port.postMessage({ type: 'famt', amount: +famt.value }); }
+  function sendFamt() { if (famt) post({ type: 'famt', amount: +famt.value }); }
   if (famt) famt.addEventListener('input', () => {
     sendFamt();
     const famtVal = document.getElementById('famtVal');
     if (famtVal) famtVal.textContent = `${+famt.value >= 0 ? '+' : ''}${(+famt.value).toFixed(0)} Hz`;
   });
   [fc, res].forEach(el => el && el.addEventListener('input', sendFilter));
+  const fmode = document.getElementById('fmode');
+  function sendFilterMode() { if (fmode) post({ type: 'filter_mode', value: +fmode.value }); }
+  if (fmode) fmode.addEventListener('change', sendFilterMode);
 
   // Filter ADSR controls
   const fatk = document.getElementById('fatk');
@@ -229,7 +424,7 @@ async function init() {
   const frel = document.getElementById('frel');
   function sendFenv() {
     if (!fatk || !fdec || !fsus || !frel) return;
-    node.port.postMessage({ type: 'fenv', attack: +fatk.value, decay: +fdec.value, sustain: +fsus.value, release: +frel.value });
+    post({ type: 'fenv', attack: +fatk.value, decay: +fdec.value, sustain: +fsus.value, release: +frel.value });
     const set = (id, text) => { const el = document.getElementById(id); if (el) el.textContent = text; };
     set('fatkVal', `${(+fatk.value).toFixed(3)} s`);
     set('fdecVal', `${(+fdec.value).toFixed(3)} s`);
@@ -265,6 +460,10 @@ async function init() {
       case 7: // fm2 index
         lfoa.min = '-10'; lfoa.max = '10'; lfoa.step = '0.05';
         break;
+      case 8: // osc1 position
+      case 9: // osc2 position
+        lfoa.min = '-1'; lfoa.max = '1'; lfoa.step = '0.01';
+        break;
       default:
         lfoa.min = '-12'; lfoa.max = '12'; lfoa.step = '0.1';
     }
@@ -276,7 +475,7 @@ async function init() {
   }
   function sendLfo() {
     const dest = lfod ? (parseInt(lfod.value,10)|0) : 0;
-    node.port.postMessage({ type: 'lfo', rate: +lfor.value, amount: +lfoa.value, dest });
+    post({ type: 'lfo', rate: +lfor.value, amount: +lfoa.value, dest });
     const rv = document.getElementById('lforVal'); if (rv) rv.textContent = `${(+lfor.value).toFixed(2)} Hz`;
     const av = document.getElementById('lfoaVal');
     if (av) {
@@ -285,6 +484,7 @@ async function init() {
       else if (dest === 2 || dest === 4 || dest === 5) unit = '';
       else if (dest === 3) unit = '';
       else if (dest === 6 || dest === 7) unit = ' idx';
+      else if (dest === 8 || dest === 9) unit = ' pos';
       av.textContent = `${(+lfoa.value).toFixed(2)} ${unit}`.trim();
     }
   }
@@ -293,7 +493,47 @@ async function init() {
   // Initialize range based on default destination
   updateLfoRange();
 
+  // Modulation matrix: LFOs 2 and 3, the mod wheel and four route slots
+  // (amounts in the destination's units, as the LFO amount)
+  const modLfos = [2, 3].map(n => ({ rate: document.getElementById(`lfo${n}rate`), shape: document.getElementById(`lfo${n}shape`) }));
+  const modRoutes = [0, 1, 2, 3].map(k => {
+    const el = id => document.getElementById(`mr${k}${id}`);
+    return { src: el('src'), dst: el('dst'), amt: el('amt') };
+  });
+  const wheel = document.getElementById('wheel');
+  function sendModLfo(i) {
+    const x = modLfos[i];
+    if (!x.rate) return;
+    post({ type: 'mod_lfo', lfo: i + 2, rate: +x.rate.value, shape: x.shape ? (parseInt(x.shape.value, 10) | 0) : 0 });
+    const v = document.getElementById(`lfo${i + 2}rateVal`); if (v) v.textContent = `${(+x.rate.value).toFixed(2)} Hz`;
+  }
+  function sendModRoute(k) {
+    const x = modRoutes[k];
+    if (!x.src || !x.dst || !x.amt) return;
+    post({ type: 'mod_route', slot: k, source: parseInt(x.src.value, 10) | 0, dest: parseInt(x.dst.value, 10) | 0, amount: +x.amt.value || 0 });
+  }
+  function sendWheel() {
+    if (!wheel) return;
+    post({ type: 'mod_wheel', value: +wheel.value });
+    const v = document.getElementById('wheelVal'); if (v) v.textContent = (+wheel.value).toFixed(2);
+  }
+  function sendMod() {
+    modLfos.forEach((_, i) => sendModLfo(i));
+    modRoutes.forEach((_, k) => sendModRoute(k));
+  }
+  modLfos.forEach((x, i) => {
+    if (x.rate) x.rate.addEventListener('input', () => sendModLfo(i));
+    if (x.shape) x.shape.addEventListener('change', () => sendModLfo(i));
+  });
+  modRoutes.forEach((x, k) => {
+    for (const el of Object.values(x)) if (el) el.addEventListener(el.tagName === 'SELECT' ? 'change' : 'input', () => sendModRoute(k));
+  });
+  if (wheel) wheel.addEventListener('input', sendWheel);
+
   // ----- Presets (stored in a cookie as JSON) -----
+  // A preset holds the control values plus, as 'bin', the engine's binary
+  // patch snapshot in base64; loading a snapshot is one message applied whole
+  // at a block boundary. Presets saved before snapshots replay every control.
   const PRESET_COOKIE = 'wt_presets';
   function readCookie(name) {
     const parts = (document.cookie || '').split(';').map(s => s.trim());
@@ -314,37 +554,57 @@ async function init() {
       wave1: wave1?.value, wave2: wave2?.value,
       det1: det1?.value, det2: det2?.value,
       gain1: gain1?.value, gain2: gain2?.value,
+      pos1: pos1?.value, pos2: pos2?.value,
       fm1car: fm1car?.value, fm1mod: fm1mod?.value, fm1idx: fm1idx?.value,
       fm2car: fm2car?.value, fm2mod: fm2mod?.value, fm2idx: fm2idx?.value,
-      fc: fc?.value, res: res?.value, famt: famt?.value,
+      fmx: fmx.map(x => Object.fromEntries(Object.entries(x).map(([k, el]) => [k, el?.value]))),
+      unx: unx.map(x => Object.fromEntries(Object.entries(x).map(([k, el]) => [k, el?.value]))),
+      modLfos: modLfos.map(x => ({ rate: x.rate?.value, shape: x.shape?.value })),
+      modRoutes: modRoutes.map(x => ({ src: x.src?.value, dst: x.dst?.value, amt: x.amt?.value })),
+      fc: fc?.value, res: res?.value, famt: famt?.value, fmode: fmode?.value,
       fatk: fatk?.value, fdec: fdec?.value, fsus: fsus?.value, frel: frel?.value,
       atk: atk?.value, dec: dec?.value, sus: sus?.value, rel: rel?.value,
       lforate: lfor?.value, lfodest: lfod?.value, lfoamnt: lfoa?.value,
-      poly: poly?.value, master: master?.value,
+      poly: poly?.value, master: master?.value, pan: pan?.value, spread: spread?.value,
     };
   }
 
+  const toBase64 = (bytes) => btoa(String.fromCharCode(...bytes));
+  const fromBase64 = (text) => Uint8Array.from(atob(text), c => c.charCodeAt(0));
+
   function applyState(s) {
     if (!s) return;
+    let snapshot = null;
+    try { snapshot = s.bin ? fromBase64(s.bin) : null; } catch { snapshot = null; }
+    if (snapshot) node.port.postMessage({ type: 'state_load', data: snapshot.buffer }, [snapshot.buffer]);
     const set = (el, v) => { if (el != null && v != null) el.value = String(v); };
     set(wave1, s.wave1); set(wave2, s.wave2);
     set(det1, s.det1); set(det2, s.det2);
     set(gain1, s.gain1); set(gain2, s.gain2);
+    set(pos1, s.pos1); set(pos2, s.pos2);
     set(fm1car, s.fm1car); set(fm1mod, s.fm1mod); set(fm1idx, s.fm1idx);
     set(fm2car, s.fm2car); set(fm2mod, s.fm2mod); set(fm2idx, s.fm2idx);
-    set(fc, s.fc); set(res, s.res); set(famt, s.famt);
+    (s.fmx || []).forEach((v, i) => { if (fmx[i] && v) for (const k in fmx[i]) set(fmx[i][k], v[k]); });
+    (s.unx || []).forEach((v, i) => { if (unx[i] && v) for (const k in unx[i]) set(unx[i][k], v[k]); });
+    (s.modLfos || []).forEach((v, i) => { if (modLfos[i] && v) for (const k in modLfos[i]) set(modLfos[i][k], v[k]); });
+    (s.modRoutes || []).forEach((v, i) => { if (modRoutes[i] && v) for (const k in modRoutes[i]) set(modRoutes[i][k], v[k]); });
+    set(fc, s.fc); set(res, s.res); set(famt, s.famt); set(fmode, s.fmode);
     set(fatk, s.fatk); set(fdec, s.fdec); set(fsus, s.fsus); set(frel, s.frel);
     set(atk, s.atk); set(dec, s.dec); set(sus, s.sus); set(rel, s.rel);
     set(lfor, s.lforate); set(lfod, s.lfodest); set(lfoa, s.lfoamnt);
-    set(poly, s.poly); set(master, s.master);
-    // Apply
+    set(poly, s.poly); set(master, s.master); set(pan, s.pan); set(spread, s.spread);
+    // Apply: refresh the readouts; the controls are only sent without a snapshot
+    holdMessages = snapshot !== null;
     updateFmVisibility();
     sendOsc1(); sendOsc2();
-    sendFilter(); if (famt) famt.dispatchEvent(new Event('input'));
+    sendFilter(); sendFilterMode(); if (famt) famt.dispatchEvent(new Event('input'));
     sendFenv(); sendEnvAndUpdate();
-    updateLfoRange(); sendLfo();
+    updateLfoRange(); sendLfo(); sendMod();
     if (poly) poly.dispatchEvent(new Event('input'));
     if (master) master.dispatchEvent(new Event('input'));
+    if (pan) pan.dispatchEvent(new Event('input'));
+    if (spread) spread.dispatchEvent(new Event('input'));
+    holdMessages = false;
   }
 
   function populatePresetSelect() {
@@ -362,11 +622,16 @@ async function init() {
 
   if (presetSelect) {
     populatePresetSelect();
-    presetSelect.addEventListener('change', () => {
+    presetSelect.addEventListener('change', async () => {
       const val = presetSelect.value; const map = loadPresetMap();
       if (val === '__save__') {
         const name = prompt('Preset name:');
-        if (name) { map[name] = collectState(); savePresetMap(map); populatePresetSelect(); presetSelect.value = name; }
+        if (name) {
+          const state = collectState();
+          const snapshot = await requestState();
+          if (snapshot) state.bin = toBase64(snapshot);
+          map[name] = state; savePresetMap(map); populatePresetSelect(); presetSelect.value = name;
+        }
         else { populatePresetSelect(); presetSelect.value = ''; }
         return;
       }
@@ -401,9 +666,11 @@ async function init() {
       await audioCtx.resume();
       setStatus();
       log('Test A4');
-      node.port.postMessage({ type: 'wave', value: parseInt(document.getElementById('wave').value, 10) | 0 });
-      node.port.postMessage({ type: 'note_on', midi: 69, velocity: 1.0 });
-      setTimeout(() => node.port.postMessage({ type: 'note_off', midi: 69 }), 500);
+      post({ type: 'wave', value: parseInt(document.getElementById('wave').value, 10) | 0 });
+      // Scheduled on the audio clock: exactly 0.5 s long
+      const start = eventFrame();
+      sendEvent(start, EV_NOTE_ON, 69, 1.0);
+      sendEvent((start + Math.round(0.5 * audioCtx.sampleRate)) >>> 0, EV_NOTE_OFF, 69);
     });
   }
 }
@@ -1,15 +1,56 @@
-export async function createWasmDSPNode(audioContext) {
+// The engine's wasm is compiled here, on the main thread, once per page:
+// streaming compilation overlaps the download, and every AudioWorkletNode (any
+// AudioContext) gets the compiled WebAssembly.Module through processorOptions,
+// so the worklet only instantiates it. scripts/build_wasm.sh emits a SIMD
+// build and a scalar one for engines without wasm SIMD.
+const DIST = new URL('./dist/', import.meta.url);
+
+// v128-returning function using i8x16.popcnt: validates only with SIMD support
+const SIMD_PROBE = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+export function wasmSimdSupported() {
+  try { return WebAssembly.validate(SIMD_PROBE); } catch { return false; }
+}
+
+let modulePromise = null;
+
+// The compiled engine module for this browser (cached)
+export function loadSynthModule() {
+  if (!modulePromise) {
+    const url = new URL(wasmSimdSupported() ? 'synth.wasm' : 'synth-nosimd.wasm', DIST);
+    modulePromise = (async () => {
+      try {
+        return await WebAssembly.compileStreaming(fetch(url));
+      } catch {
+        // Served without the application/wasm type: compile from the bytes
+        const res = await fetch(url);
+        if (!res.ok) throw new Error(`Failed to fetch ${url}: ${res.status}`);
+        return WebAssembly.compile(await res.arrayBuffer());
+      }
+    })();
+    modulePromise.catch(() => { modulePromise = null; });
+  }
+  return modulePromise;
+}
+
+// options.processorOptions are passed on to the worklet (parts, governor)
+export async function createWasmDSPNode(audioContext, options = {}) {
   if (!audioContext?.audioWorklet) {
     throw new Error('AudioWorklet not supported');
   }
-  await audioContext.audioWorklet.addModule('worklet/synth-processor.js');
+  const [module] = await Promise.all([
+    loadSynthModule(),
+    audioContext.audioWorklet.addModule(new URL('./worklet/synth-processor.js', import.meta.url))
+  ]);
   const node = new AudioWorkletNode(audioContext, 'synth-processor', {
     numberOfInputs: 0,
     numberOfOutputs: 1,
     outputChannelCount: [2],
-    parameterData: { gain: 1.0 }
+    parameterData: { gain: 1.0 },
+    processorOptions: { ...options.processorOptions, module }
   });
   node.connect(audioContext.destination);
   return node;
 }
-
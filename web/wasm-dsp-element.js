@@ -1,4 +1,4 @@
-import { createWasmDSPNode } from './player.js';
+import { createWasmDSPNode, loadSynthModule } from './player.js';
 
 const template = document.createElement('template');
 template.innerHTML = `
@@ -32,6 +32,8 @@ export class WasmDSPElement extends HTMLElement {
   }
 
   connectedCallback() {
+    // Compile the engine now, so pressing Start only instantiates it
+    loadSynthModule().catch(() => {});
     this.$start.addEventListener('click', this.handleStart);
     this.$gain.addEventListener('input', this.handleGain);
 
@@ -2,133 +2,191 @@
 // ESM import of the Emscripten factory (built with EXPORT_ES6=1)
 import createSynthModule from '../dist/synth.js';
 
+// SynthEventType values from src/wavetable_synth.h
+const EV = {
+  NOTE_ON: 1, NOTE_OFF: 2, AMP: 3, WAVE: 4, WAVE1: 5, WAVE2: 6, DETUNE1: 7, DETUNE2: 8,
+  GAIN1: 9, GAIN2: 10, FM1: 11, FM2: 12, ENV: 13, POLY: 14, FILTER: 15, FILTER_ENV: 16,
+  FILTER_ENV_AMOUNT: 17, FILTER_ENABLE: 18, LFO_RATE: 19, LFO_DEST: 20, LFO_AMOUNT: 21, SMOOTHING: 22,
+  WAVE_CROSSFADE: 23, POSITION1: 24, POSITION2: 25, PAN: 26, SPREAD: 27, FILTER_MODE: 28,
+  FM_ALGORITHM: 29, FM_FEEDBACK: 30, FM_OP: 31, FM_OP_ENV: 32, UNISON: 33, UNISON_PHASE: 34,
+  MOD_ROUTE: 35, MOD_LFO: 36, MOD_WHEEL: 37
+};
+// Event ring layout (EventQueue in src/event_queue.h): 8 u32 header words
+// (write, read, capacity, pad), then 32-byte records
+// [frame u32, type i32, i i32, a f32, b f32, c f32, d f32, part u32]. The engine
+// ignores the last word; in the shared ring it selects the target part.
+const RING_HEADER_WORDS = 8;
+const RING_EVENT_WORDS = 8;
+const RING_CAPACITY = 1024;
+const MAX_PARTS = 16;
+// SynthStats (src/synth_stats.h): one block of 32-bit words per part
+const STATS_WORDS = 19;
+const STATS_POST_INTERVAL = 32; // callbacks between stats messages without shared memory
+
 class SynthProcessor extends AudioWorkletProcessor {
   static get parameterDescriptors() {
     return [
       { name: 'gain', defaultValue: 1.0, minValue: 0.0, maxValue: 4.0 }
     ];
   }
-  constructor() {
+  // processorOptions.module: the engine's compiled WebAssembly.Module
+  // (web/player.js compiles it once per page); this scope cannot fetch, so
+  // there is no fallback.
+  // processorOptions.parts: number of independent engines (e.g. one per MIDI
+  // channel) rendered in this one module and summed; events carry a part index.
+  // processorOptions.governor: false turns off the engines' CPU governor.
+  constructor(options) {
     super();
+    const po = (options && options.processorOptions) || {};
+    this.partCount = Math.min(Math.max(po.parts | 0, 1), MAX_PARTS);
+    this.governor = po.governor !== false;
     this.ready = false;
     this.mod = null;
+    this.synths = [];
+    this.queues = [];
+    // Planar output (ptrCapacity frames per channel) and the gain ramp handed
+    // to synth_render_planar, in the WASM heap
     this.ptr = 0;
     this.ptrCapacity = 0;
+    this.channels = 0;
+    this.gainPtr = 0;
+    this.lastGain = 1.0;
     this.processCount = 0;
+    // Each part's stats block in the heap, mirrored after every block into a
+    // SharedArrayBuffer the page polls; posted periodically as a fallback
+    this.statsPtrs = [];
+    this.stats = null;
+    this.statsU32 = null;
+    // User wavetables in the WASM heap, per part and oscillator: { wave, ptr }
+    this.tables = [];
+    // Replaced tables kept until the engine no longer plays or fades from them
+    this.retired = [];
+    // Heap buffer patch snapshots pass through (synth_get_state/synth_load_state)
+    this.statePtr = 0;
+    this.stateCapacity = 0;
+
+    // Main-thread event ring (SharedArrayBuffer, same layout as the engine's
+    // EventQueue) when cross-origin isolated; drained at the top of process()
+    this.ring = null;
+    this.ringU32 = null;
+    this.ringF32 = null;
 
-    // Handle messages from main thread (UI)
+    // Handle messages from main thread (UI). Everything becomes an engine event,
+    // except wavetable uploads, which are answered with the wave number, and
+    // patch snapshots, which go to synth_get_state/synth_load_state.
     this.port.onmessage = (ev) => {
       const m = ev.data || {};
       if (!this.mod || !this.ready) return;
-      try {
-        switch (m.type) {
-          case 'wave':
-            // Backwards-compat: set both oscillators' wave
-            this.mod.ccall('synth_set_wave', 'void', ['number'], [m.value|0]);
-            this.port.postMessage({ type: 'log', msg: `wave -> ${m.value|0}` });
-            break;
-          case 'osc1': {
-            if (typeof m.wave === 'number') this.mod.ccall('synth_set_wave1', 'void', ['number'], [m.wave|0]);
-            if (typeof m.detune === 'number') this.mod.ccall('synth_set_detune1', 'void', ['number'], [m.detune]);
-            if (typeof m.gain === 'number') this.mod.ccall('synth_set_gain1', 'void', ['number'], [m.gain]);
-            if (typeof m.fm_car === 'number' || typeof m.fm_mod === 'number' || typeof m.fm_indx === 'number') {
-              const car = typeof m.fm_car === 'number' ? m.fm_car : 1.0;
-              const mod = typeof m.fm_mod === 'number' ? m.fm_mod : 1.0;
-              const idx = typeof m.fm_indx === 'number' ? m.fm_indx : 2.0;
-              this.mod.ccall('synth_fm1', 'void', ['number','number','number'], [car, mod, idx]);
-            }
-            this.port.postMessage({ type: 'log', msg: `osc1 -> wave:${m.wave} det:${m.detune}` });
-            break;
-          }
-          case 'osc2': {
-            if (typeof m.wave === 'number') this.mod.ccall('synth_set_wave2', 'void', ['number'], [m.wave|0]);
-            if (typeof m.detune === 'number') this.mod.ccall('synth_set_detune2', 'void', ['number'], [m.detune]);
-            if (typeof m.gain === 'number') this.mod.ccall('synth_set_gain2', 'void', ['number'], [m.gain]);
-            if (typeof m.fm_car === 'number' || typeof m.fm_mod === 'number' || typeof m.fm_indx === 'number') {
-              const car = typeof m.fm_car === 'number' ? m.fm_car : 1.0;
-              const mod = typeof m.fm_mod === 'number' ? m.fm_mod : 1.0;
-              const idx = typeof m.fm_indx === 'number' ? m.fm_indx : 2.0;
-              this.mod.ccall('synth_fm2', 'void', ['number','number','number'], [car, mod, idx]);
-            }
-            this.port.postMessage({ type: 'log', msg: `osc2 -> wave:${m.wave} det:${m.detune}` });
-            break;
-          }
-          case 'note_on':
-            this.mod.ccall('synth_note_on', 'void', ['number', 'number'], [m.midi|0, m.velocity ?? 1.0]);
-            this.port.postMessage({ type: 'log', msg: `note_on -> midi:${m.midi|0} vel:${m.velocity??1.0}` });
-            break;
-          case 'note_off':
-            if (typeof m.midi === 'number') {
-              this.mod.ccall('synth_note_off_midi', 'void', ['number'], [m.midi|0]);
-              this.port.postMessage({ type: 'log', msg: `note_off -> midi:${m.midi|0}` });
-            } else {
-              this.mod.ccall('synth_note_off', 'void', [], []);
-              this.port.postMessage({ type: 'log', msg: 'note_off (all)' });
-            }
-            break;
-          case 'amp':
-            this.mod.ccall('synth_set_amp', 'void', ['number'], [m.value || 0]);
-            this.port.postMessage({ type: 'log', msg: `amp -> ${m.value||0}` });
-            break;
-          case 'filter': {
-            const cutoff = +m.cutoff || 0;
-            let res = +m.resonance; if (!Number.isFinite(res)) res = 0;
-            this.mod.ccall('synth_filter_set', 'void', ['number','number'], [cutoff, res]);
-            this.port.postMessage({ type: 'log', msg: `filter -> fc:${cutoff}Hz res:${res}` });
-            break;
-          }
-          case 'fenv': {
-            const a = +m.attack||0, d = +m.decay||0, s = +m.sustain||0, r = +m.release||0;
-            this.mod.ccall('synth_filter_env', 'void', ['number','number','number','number'], [a,d,s,r]);
-            this.port.postMessage({ type: 'log', msg: `fenv -> a:${a} d:${d} s:${s} r:${r}` });
-            break;
-          }
-          case 'famt': {
-            const amt = +m.amount||0;
-            this.mod.ccall('synth_filter_env_amount', 'void', ['number'], [amt]);
-            this.port.postMessage({ type: 'log', msg: `famt -> ${amt} Hz` });
-            break;
+      const E = EV;
+      const part = m.part | 0;
+      const push = (frame, type, i, a, b, c, d) => this.push(part, frame, type, i, a, b, c, d);
+      switch (m.type) {
+        case 'events': {
+          // Flat [frame, type, i, a, b, c, d] records
+          const e = m.events || [];
+          for (let k = 0; k + 6 < e.length; k += 7) push(e[k], e[k+1], e[k+2], e[k+3], e[k+4], e[k+5], e[k+6]);
+          break;
+        }
+        // Legacy per-control messages, applied at the next block
+        case 'wave': push(0, E.WAVE, m.value|0); break;
+        case 'osc1':
+        case 'osc2': {
+          const two = m.type === 'osc2';
+          if (typeof m.wave === 'number') push(0, two ? E.WAVE2 : E.WAVE1, m.wave|0);
+          if (typeof m.detune === 'number') push(0, two ? E.DETUNE2 : E.DETUNE1, 0, m.detune);
+          if (typeof m.gain === 'number') push(0, two ? E.GAIN2 : E.GAIN1, 0, m.gain);
+          if (typeof m.position === 'number') push(0, two ? E.POSITION2 : E.POSITION1, 0, m.position);
+          if (typeof m.fm_car === 'number' || typeof m.fm_mod === 'number' || typeof m.fm_indx === 'number') {
+            const car = typeof m.fm_car === 'number' ? m.fm_car : 1.0;
+            const mod = typeof m.fm_mod === 'number' ? m.fm_mod : 1.0;
+            const idx = typeof m.fm_indx === 'number' ? m.fm_indx : 2.0;
+            push(0, two ? E.FM2 : E.FM1, 0, car, mod, idx);
           }
-          case 'lfo': {
-            if (typeof m.rate === 'number') {
-              this.mod.ccall('synth_lfo_set', 'void', ['number'], [m.rate]);
-            }
-            if (typeof m.dest === 'number') {
-              this.mod.ccall('synth_lfo_dest', 'void', ['number'], [m.dest|0]);
-            }
-            if (typeof m.amount === 'number') {
-              this.mod.ccall('synth_lfo_amount', 'void', ['number'], [m.amount]);
-            }
-            this.port.postMessage({ type: 'log', msg: `lfo -> rate:${m.rate} dest:${m.dest} amt:${m.amount}` });
-            break;
+          // Four-operator FM: fm_ops entries are { op (1..4), ratio, level }
+          const osc = two ? 2 : 1;
+          if (typeof m.fm_algorithm === 'number') push(0, E.FM_ALGORITHM, osc, m.fm_algorithm);
+          if (typeof m.fm_feedback === 'number') push(0, E.FM_FEEDBACK, osc, m.fm_feedback);
+          for (const o of (Array.isArray(m.fm_ops) ? m.fm_ops : [])) {
+            push(0, E.FM_OP, (osc - 1) * 4 + ((o.op | 0) - 1), +o.ratio || 0, +o.level || 0);
           }
-          case 'env': {
-            const a = +m.attack||0, d = +m.decay||0, s = +m.sustain||0, r = +m.release||0;
-            this.mod.ccall('synth_set_env', 'void', ['number','number','number','number'], [a,d,s,r]);
-            this.port.postMessage({ type: 'log', msg: `env -> a:${a} d:${d} s:${s} r:${r}` });
-            break;
+          // Unison stack: { voices (1..16), detune (semitones), curve, width, random }
+          if (m.unison && typeof m.unison === 'object') {
+            const u = m.unison;
+            push(0, E.UNISON, osc, Math.max(1, u.voices | 0), +u.detune || 0, +u.curve || 0, +u.width || 0);
+            if (typeof u.random === 'number') push(0, E.UNISON_PHASE, osc, u.random);
           }
-          case 'poly':
-            this.mod.ccall('synth_set_poly', 'void', ['number'], [m.value|0]);
-            this.port.postMessage({ type: 'log', msg: `poly -> ${m.value|0}` });
-            break;
+          break;
+        }
+        case 'note_on': push(0, E.NOTE_ON, m.midi|0, m.velocity ?? 1.0); break;
+        case 'note_off': push(0, E.NOTE_OFF, typeof m.midi === 'number' ? m.midi|0 : -1); break;
+        case 'amp': push(0, E.AMP, 0, m.value || 0); break;
+        case 'pan': push(0, E.PAN, 0, +m.value || 0); break;
+        case 'spread': push(0, E.SPREAD, 0, +m.value || 0); break;
+        case 'filter': {
+          let res = +m.resonance; if (!Number.isFinite(res)) res = 0;
+          push(0, E.FILTER, 0, +m.cutoff || 0, res);
+          break;
         }
-      } catch (e) {
-        // Avoid throwing in the audio thread
+        case 'fenv': push(0, E.FILTER_ENV, 0, +m.attack||0, +m.decay||0, +m.sustain||0, +m.release||0); break;
+        case 'famt': push(0, E.FILTER_ENV_AMOUNT, 0, +m.amount||0); break;
+        case 'filter_mode': push(0, E.FILTER_MODE, m.value|0); break;
+        // Modulation matrix: route slot 0..15 (source -1 empties it), LFO 2/3, mod wheel
+        case 'mod_route': push(0, E.MOD_ROUTE, m.slot|0, m.source|0, m.dest|0, +m.amount || 0); break;
+        case 'mod_lfo': push(0, E.MOD_LFO, m.lfo|0, +m.rate || 0, m.shape|0); break;
+        case 'mod_wheel': push(0, E.MOD_WHEEL, 0, +m.value || 0); break;
+        case 'lfo':
+          if (typeof m.rate === 'number') push(0, E.LFO_RATE, 0, m.rate);
+          if (typeof m.dest === 'number') push(0, E.LFO_DEST, m.dest|0);
+          if (typeof m.amount === 'number') push(0, E.LFO_AMOUNT, 0, m.amount);
+          break;
+        case 'env': push(0, E.ENV, 0, +m.attack||0, +m.decay||0, +m.sustain||0, +m.release||0); break;
+        case 'poly': push(0, E.POLY, m.value|0); break;
+        case 'wavetable': this.loadWavetable(part, m); break;
+        // Patch snapshots: the whole patch in one call, applied at the next block
+        case 'state_get': this.getState(part, m.id); break;
+        case 'state_load': this.loadState(part, m.data); break;
+        // Telemetry counters of the addressed part only
+        case 'stats_reset': if (this.synths[part] !== undefined) this.mod._synth_stats_reset(this.synths[part]); break;
       }
     };
 
-    // Instantiate the WASM module inside the worklet
-    // Ensure the .wasm path is resolved relative to dist/
-    const opts = {};
+    // Instantiate the precompiled module; nothing is compiled on this thread
+    const wasmModule = po.module;
+    if (!(wasmModule instanceof WebAssembly.Module)) {
+      this.port.postMessage({ type: 'error', msg: 'No wasm module in processorOptions (create the node with player.js)' });
+      return;
+    }
+    const opts = {
+      instantiateWasm: (imports, receiveInstance) => {
+        const instance = new WebAssembly.Instance(wasmModule, imports);
+        receiveInstance(instance, wasmModule);
+        return instance.exports;
+      }
+    };
     createSynthModule(opts).then((mod) => {
       this.mod = mod;
       const sr = sampleRate | 0; // global in AW scope
-      this.mod.ccall('synth_init', 'void', ['number', 'number'], [sr, 2048]);
-      this.ptrCapacity = 2048; // frames
-      this.ptr = this.mod._malloc(this.ptrCapacity * 4);
+      for (let p = 0; p < this.partCount; p++) {
+        const h = this.mod._synth_create(sr, 2048);
+        this.synths.push(h);
+        this.queues.push(this.mod._synth_event_queue(h));
+        this.statsPtrs.push(this.mod._synth_stats(h));
+        // Realtime host: shed quality rather than miss the block deadline
+        this.mod._synth_set_governor(h, this.governor ? 1 : 0, 0, 0);
+      }
+      this.allocOutput(128, 2);
+      if (typeof SharedArrayBuffer !== 'undefined') {
+        this.ring = new SharedArrayBuffer((RING_HEADER_WORDS + RING_CAPACITY * RING_EVENT_WORDS) * 4);
+        this.ringU32 = new Uint32Array(this.ring);
+        this.ringF32 = new Float32Array(this.ring);
+        this.ringU32[2] = RING_CAPACITY;
+        this.stats = new SharedArrayBuffer(this.partCount * STATS_WORDS * 4);
+        this.statsU32 = new Uint32Array(this.stats);
+      }
       this.ready = true;
-      this.port.postMessage({ type: 'ready', sr });
+      // Engine memory, all of it reserved at creation (synth_memory_bytes)
+      const memory = this.synths.reduce((sum, h) => sum + this.mod._synth_memory_bytes(h), 0);
+      this.port.postMessage({ type: 'ready', sr, parts: this.partCount, ring: this.ring, stats: this.stats, memory });
     }).catch(() => {
       // stay silent on failure
       this.ready = false;
@@ -136,44 +194,195 @@ class SynthProcessor extends AudioWorkletProcessor {
     });
   }
 
+  // Append one event to a part's queue in the WASM heap (this thread is its
+  // only producer). Dropped if the queue is full or the part does not exist.
+  push(part, frame, type, i = 0, a = 0, b = 0, c = 0, d = 0) {
+    const queue = this.queues[part];
+    if (queue === undefined) return false;
+    const u32 = this.mod.HEAPU32, i32 = this.mod.HEAP32, f32 = this.mod.HEAPF32;
+    const h = queue >> 2;
+    const w = u32[h], cap = u32[h + 2];
+    if (((w - u32[h + 1]) >>> 0) >= cap) return false;
+    const e = h + RING_HEADER_WORDS + (w & (cap - 1)) * RING_EVENT_WORDS;
+    u32[e] = frame >>> 0; i32[e + 1] = type | 0; i32[e + 2] = i | 0;
+    f32[e + 3] = a; f32[e + 4] = b; f32[e + 5] = c; f32[e + 6] = d;
+    u32[h] = (w + 1) >>> 0;
+    return true;
+  }
+
+  // Copy an uploaded wavetable into a heap buffer the engine reads in place and
+  // select it on the oscillator. The buffer lives until the oscillator's next
+  // upload replaces it (the new table is created first, so it gets a new slot)
+  // and the switch has crossfaded away from it (releaseRetired).
+  loadWavetable(part, m) {
+    const h = this.synths[part];
+    const frames = m.frames | 0, size = m.size | 0;
+    const osc = m.osc === 2 ? 2 : 1;
+    let wave = -1;
+    if (h !== undefined && m.data && frames > 0 && size > 0 && m.data.length >= frames * size &&
+        this.mipsFit(frames, size)) {
+      const ptr = this.mod._malloc(frames * size * 4);
+      if (ptr) {
+        this.mod.HEAPF32.set(m.data.subarray(0, frames * size), ptr >> 2);
+        wave = this.mod._synth_wavetable_create(h, ptr, frames, size);
+      }
+      if (wave < 0) {
+        if (ptr) this.mod._free(ptr);
+      } else {
+        const key = part * 2 + osc - 1;
+        const old = this.tables[key];
+        if (old) this.retired.push({ part, wave: old.wave, ptr: old.ptr });
+        this.tables[key] = { wave, ptr };
+        this.push(part, 0, osc === 2 ? EV.WAVE2 : EV.WAVE1, wave);
+      }
+    }
+    this.port.postMessage({ type: 'wavetable', part, osc, name: m.name, frames, wave });
+  }
+
+  // Release replaced tables once no oscillator plays or crossfades from them
+  releaseRetired() {
+    for (let k = this.retired.length - 1; k >= 0; k--) {
+      const t = this.retired[k], h = this.synths[t.part];
+      if (this.mod._synth_wavetable_in_use(h, t.wave)) continue;
+      this.mod._synth_wavetable_release(h, t.wave);
+      this.mod._free(t.ptr);
+      this.retired.splice(k, 1);
+    }
+  }
+
+  // The heap has a fixed size (no growth on the audio thread), and a table's
+  // mip levels (frames * levels * (size + 1) floats, see FrameTable) are
+  // allocated in one piece by synth_wavetable_create: check they fit first
+  mipsFit(frames, size) {
+    let levels = 1;
+    while (((size >> 1) >> levels) >= 1) levels++;
+    const bytes = frames * levels * (size + 1) * 4 + frames * size * 4;
+    const probe = this.mod._malloc(bytes);
+    if (!probe) return false;
+    this.mod._free(probe);
+    return true;
+  }
+
+  // Heap buffer of at least 'bytes' for patch snapshots; grows, never shrinks
+  stateBuffer(bytes) {
+    if (bytes > this.stateCapacity) {
+      if (this.statePtr) this.mod._free(this.statePtr);
+      this.statePtr = this.mod._malloc(bytes);
+      this.stateCapacity = bytes;
+    }
+    return this.statePtr;
+  }
+
+  // Reply with the part's current patch snapshot (null for a missing part)
+  getState(part, id) {
+    const h = this.synths[part];
+    let data = null;
+    if (h !== undefined) {
+      const size = this.mod._synth_get_state(h, 0, 0);
+      const ptr = this.stateBuffer(size);
+      if (this.mod._synth_get_state(h, ptr, size) === size) data = this.mod.HEAPU8.slice(ptr, ptr + size).buffer;
+    }
+    this.port.postMessage({ type: 'state', part, id, data }, data ? [data] : []);
+  }
+
+  loadState(part, data) {
+    const h = this.synths[part];
+    if (h === undefined || !data) return;
+    const bytes = new Uint8Array(data);
+    const ptr = this.stateBuffer(bytes.length);
+    this.mod.HEAPU8.set(bytes, ptr);
+    if (!this.mod._synth_load_state(h, ptr, bytes.length)) {
+      this.port.postMessage({ type: 'log', msg: 'Preset snapshot rejected (corrupt or from a newer version)' });
+    }
+  }
+
+  // Move everything the main thread wrote into the shared ring to the engine
+  drainRing() {
+    const r32 = this.ringU32, rf = this.ringF32;
+    let r = Atomics.load(r32, 1);
+    const w = Atomics.load(r32, 0);
+    while (r !== w) {
+      const e = RING_HEADER_WORDS + (r & (RING_CAPACITY - 1)) * RING_EVENT_WORDS;
+      const part = r32[e + 7];
+      if (!this.push(part, r32[e], r32[e + 1] | 0, r32[e + 2] | 0, rf[e + 3], rf[e + 4], rf[e + 5], rf[e + 6]) &&
+          part < this.partCount) break; // queue full: retry next block
+
+      r = (r + 1) >>> 0;
+    }
+    Atomics.store(r32, 1, r);
+  }
+
+  // (Re)allocate the planar output and gain buffers; only when the block size
+  // or channel count changes
+  allocOutput(frames, channels) {
+    if (this.ptr) this.mod._free(this.ptr);
+    if (this.gainPtr) this.mod._free(this.gainPtr);
+    this.ptrCapacity = frames;
+    this.channels = channels;
+    this.ptr = this.mod._malloc(frames * channels * 4);
+    this.gainPtr = this.mod._malloc(frames * 4);
+  }
+
   process(inputs, outputs, parameters) {
     const output = outputs[0];
     const frames = output[0].length;
+    const channels = output.length;
 
     if (!this.ready || !this.mod) {
-      for (let ch = 0; ch < output.length; ch++) output[ch].fill(0);
+      for (let ch = 0; ch < channels; ch++) output[ch].fill(0);
       return true;
     }
 
-    if (frames > this.ptrCapacity) {
-      if (this.ptr) this.mod._free(this.ptr);
-      this.ptrCapacity = frames;
-      this.ptr = this.mod._malloc(this.ptrCapacity * 4);
+    if (frames > this.ptrCapacity || channels !== this.channels) {
+      this.allocOutput(Math.max(frames, this.ptrCapacity), channels);
     }
 
-    // Render mono block into WASM heap
-    this.mod.ccall('synth_render', 'void', ['number', 'number'], [this.ptr, frames]);
+    // Gain goes to the engine: per frame when automated, otherwise a ramp from
+    // the previous block's value so steps do not click
+    const gain = parameters.gain;
+    let gainCount;
+    if (gain.length > 1) {
+      this.mod.HEAPF32.set(gain, this.gainPtr >> 2);
+      gainCount = frames;
+      this.lastGain = gain[gain.length - 1];
+    } else {
+      this.mod.HEAPF32[this.gainPtr >> 2] = this.lastGain;
+      this.mod.HEAPF32[(this.gainPtr >> 2) + 1] = gain[0];
+      gainCount = this.lastGain === gain[0] ? 1 : 2;
+      this.lastGain = gain[0];
+    }
+
+    // Run the engines on the context timeline so event frames line up with
+    // currentFrame, then render; events split the block at their frame. Each
+    // part adds into the shared planar buffer.
+    if (this.ring) this.drainRing();
+    for (let p = 0; p < this.partCount; p++) {
+      this.mod._synth_set_frame(this.synths[p], currentFrame >>> 0);
+      this.mod._synth_render_planar(this.synths[p], this.ptr, this.ptrCapacity, channels, frames,
+                                    this.gainPtr, gainCount, p > 0 ? 1 : 0);
+    }
+    const heap = this.mod.HEAPF32;
     const start = this.ptr >> 2;
-    const heap = this.mod.HEAPF32.subarray(start, start + frames);
-
-    // Copy mono to all output channels
-    for (let i = 0; i < frames; i++) {
-      const base = heap[i];
-      const g = (parameters && parameters.gain && parameters.gain.length)
-        ? (parameters.gain.length > 1 ? parameters.gain[i] : parameters.gain[0])
-        : 1.0;
-      const s = base * g;
-      for (let ch = 0; ch < output.length; ch++) {
-        output[ch][i] = s;
-      }
+    for (let ch = 0; ch < channels; ch++) {
+      const o = start + ch * this.ptrCapacity;
+      output[ch].set(heap.subarray(o, o + frames));
     }
+    if (this.retired.length) this.releaseRetired();
 
-    // lightweight diagnostics (rms) every ~8 callbacks
-    if ((this.processCount++ & 7) === 0) {
-      let sum = 0;
-      for (let i = 0; i < frames; i++) { const v = heap[i]; sum += v*v; }
-      const rms = Math.sqrt(sum / frames);
-      this.port.postMessage({ type: 'metrics', frames, rms });
+    // Telemetry: copy the engines' stats blocks out, no allocation
+    if (this.statsU32) {
+      const u32 = this.mod.HEAPU32;
+      for (let p = 0; p < this.partCount; p++) {
+        const o = this.statsPtrs[p] >> 2;
+        this.statsU32.set(u32.subarray(o, o + STATS_WORDS), p * STATS_WORDS);
+      }
+    } else if (this.processCount++ % STATS_POST_INTERVAL === 0) {
+      const words = new Uint32Array(this.partCount * STATS_WORDS);
+      for (let p = 0; p < this.partCount; p++) {
+        const o = this.statsPtrs[p] >> 2;
+        words.set(this.mod.HEAPU32.subarray(o, o + STATS_WORDS), p * STATS_WORDS);
+      }
+      this.port.postMessage({ type: 'stats', words: words.buffer }, [words.buffer]);
     }
     return true;
   }